@@ -15,14 +15,19 @@
 
 #include <fstream>
 #include <string>
+#include <algorithm>
 
 #include <netinet/in.h>
+#include <sys/stat.h>
 
 #include <VSDataConverter.hpp>
 #include <VSDBParameterTable.hpp>
 #include <VSDataConverter.hpp>
 
 #include "DTED.hpp"
+#include "DTEDTileIndex.hpp"
+#include "DTEDParallel.hpp"
+#include "DTEDTileReader.hpp"
 
 using namespace VERITAS;
 
@@ -30,7 +35,98 @@ using namespace VERITAS;
 // DTED Map
 // ----------------------------------------------------------------------------
 
-void DTEDMap::merge(const DTEDMap& map)
+namespace
+{
+  // Interleave the bits of x and y (x in the even bits)
+  uint64_t mortonCode(uint32_t x, uint32_t y)
+  {
+    uint64_t code = 0;
+    for(unsigned i=0;i<32;i++)
+      code |= (uint64_t((x>>i)&1)<<(2*i)) | (uint64_t((y>>i)&1)<<(2*i+1));
+    return code;
+  }
+}
+
+void DTEDMap::setBlockOffsets()
+{
+  // Blocks are numbered by Z-order among those the map has, so there is
+  // no padding beyond the edge blocks whatever the map dimensions
+  fBlocksX = (fWidth+BLOCK_MASK)>>BLOCK_BITS;
+  const unsigned ny = (fHeight+BLOCK_MASK)>>BLOCK_BITS;
+  std::vector<std::pair<uint64_t,unsigned> > order(fBlocksX*ny);
+  for(unsigned by=0;by<ny;by++)
+    for(unsigned bx=0;bx<fBlocksX;bx++)
+      order[by*fBlocksX+bx] =
+	std::make_pair(mortonCode(bx,by), by*fBlocksX+bx);
+  std::sort(order.begin(), order.end());
+
+  fBlockOffset.resize(order.size());
+  for(unsigned i=0;i<order.size();i++)
+    fBlockOffset[order[i].second] = i*uint32_t(BLOCK_SAMPLES);
+}
+
+void DTEDMap::fill(int16_t value)
+{
+  // Below a few MB thread start-up costs more than the fill
+  const size_t PARALLEL_FILL_SAMPLES = 1<<20;
+  if(size() < PARALLEL_FILL_SAMPLES)
+    {
+      std::fill(fData, fData+size(), value);
+      return;
+    }
+
+#pragma omp parallel
+  {
+    unsigned band_begin;
+    unsigned band_end;
+    if(fLayout == L_ROWS)
+      {
+	dtedThreadBand(fHeight, band_begin, band_end);
+	std::fill(fData+size_t(band_begin)*fWidth,
+		  fData+size_t(band_end)*fWidth, value);
+      }
+    else
+      {
+	dtedThreadBand((fHeight+BLOCK_MASK)>>BLOCK_BITS, band_begin, band_end);
+	for(unsigned by=band_begin;by<band_end;by++)
+	  for(unsigned bx=0;bx<fBlocksX;bx++)
+	    {
+	      int16_t* block = fData+fBlockOffset[by*fBlocksX+bx];
+	      std::fill(block, block+BLOCK_SAMPLES, value);
+	    }
+      }
+  }
+}
+
+DTEDMapPtr DTEDMap::convert(Layout layout, DTEDAllocator* allocator) const
+{
+  DTEDMapPtr map(new DTEDMap(fWidth, fHeight, fLeft, fBottom, fResolution,
+			     -32768, allocator, layout));
+  if((fWidth == 0)||(fHeight == 0))return map;
+
+  // Work through the map in block rows, copying one run of up to a
+  // block's width at a time; in rows or blocks each run is contiguous.
+  // Threads take contiguous bands of block rows, close to those they
+  // filled in the constructor.
+  const DTEDMap& src = *this;
+  DTEDMap& dst = *map;
+  const int nby = int((fHeight+BLOCK_MASK)>>BLOCK_BITS);
+#pragma omp parallel for schedule(static)
+  for(int by=0;by<nby;by++)
+    {
+      const unsigned y0 = unsigned(by)<<BLOCK_BITS;
+      const unsigned y1 = std::min(y0+unsigned(BLOCK_SIZE), fHeight);
+      for(unsigned x0=0;x0<fWidth;x0+=BLOCK_SIZE)
+	{
+	  const unsigned n = std::min(unsigned(BLOCK_SIZE), fWidth-x0);
+	  for(unsigned y=y0;y<y1;y++)
+	    std::copy(&src.datum(x0,y), &src.datum(x0,y)+n, &dst.datum(x0,y));
+	}
+    }
+  return map;
+}
+
+void DTEDMap::merge(const DTEDView& map)
 {
   assert(map.resolution() == resolution());
 
@@ -79,64 +175,312 @@ void DTEDMap::merge(const DTEDMap& map)
     }
 }
 
-DTEDMap* DTEDMap::loadMap(const std::string& filename,
-			  unsigned w, unsigned h, 
-			  int32_t left, int32_t bottom, 
-			  uint32_t resolution)
+bool DTEDMap::mergeMap(const std::string& filename,
+		       unsigned w, unsigned h, int32_t left, int32_t bottom)
 {
-  FILE* fp = fopen(filename.c_str(), "r");
-  if(!fp)return 0;
+  return mergeFile(filename, w, h, left, bottom, 0);
+}
 
-  int16_t* data = new int16_t[w*h];
+bool DTEDMap::mergeFile(const std::string& filename,
+			unsigned w, unsigned h, int32_t left, int32_t bottom,
+			const bool* later)
+{
+  DTEDTileReader reader;
+  if(!reader.open(filename))return false;
+
+  // A sample on an edge or corner of the file is left to a later tile if
+  // any later tile beside it, on that edge or around that corner, has it
+  bool skip[9] = { };
+  bool skipping = false;
+  if(later)
+    for(int dy=-1;dy<=1;dy++)
+      for(int dx=-1;dx<=1;dx++)
+	if(dx||dy)
+	  {
+	    bool& s = skip[(dy+1)*3+dx+1];
+	    s = later[(dy+1)*3+dx+1] ||
+	      (dx && later[4+dx]) || (dy && later[(dy+1)*3+1]);
+	    skipping |= s;
+	  }
+
+  // Overlap of the file with this map, as in merge()
+  DTEDView file(0, w, h, w, left, bottom, resolution());
+  int32_t l_this = std::max(xOf(file.left()), 0);
+  int32_t r_this = std::min(xOf(file.right()), int32_t(width()));
+  int32_t b_this = std::max(yOf(file.bottom()), 0);
+  int32_t t_this = std::min(yOf(file.top()), int32_t(height()));
+
+  bool good = true;
+  if((r_this>l_this)&&(t_this>b_this))
+    {
+      const int32_t l_that = file.xOf(xCoordOf(l_this));
+      const int32_t b_that = file.yOf(yCoordOf(b_this));
+      const unsigned n = unsigned(r_this-l_this);
+
+      // Rows are stored from the top down, so read them in file order:
+      // seeking to each where the file allows, otherwise inflating past
+      // what is not wanted. Rows go straight into place unless the map is
+      // blocked or some samples are left to other tiles.
+      std::vector<int16_t> buffer((fLayout==L_ROWS && !skipping) ? 0 : n);
+      uint64_t position = 0;
+      for(int32_t y=t_this-1; good && y>=b_this; y--)
+	{
+	  const unsigned fy = unsigned(y-b_this+b_that);
+	  const uint64_t offset =
+	    ((uint64_t(h)-1-fy)*w+unsigned(l_that))*sizeof(int16_t);
+	  int16_t* data = buffer.empty() ? &datum(l_this,y) : &buffer.front();
+	  good = (reader.seekable() ? reader.seek(offset) :
+		  reader.skip(offset-position))
+	    && reader.read(data, n*sizeof(*data));
+	  position = offset+n*sizeof(*data);
+	  for(unsigned x=0;x<n;x++)data[x] = ntohs(data[x]);
+	  if(buffer.empty())continue;
+
+	  const int dy = (fy==0) ? -1 : (fy==h-1) ? 1 : 0;
+	  for(unsigned x=0;x<n;x++)
+	    {
+	      const unsigned fx = unsigned(l_that)+x;
+	      const int dx = (fx==0) ? -1 : (fx==w-1) ? 1 : 0;
+	      if(!skip[(dy+1)*3+dx+1])datum(l_this+x,y) = data[x];
+	    }
+	}
+    }
+  return good;
+}
+
+unsigned DTEDMap::mergeSRTMTiles(const std::vector<std::string>& filenames,
+				 std::vector<bool>* loaded)
+{
+  const int32_t res = int32_t(resolution());
+  const unsigned n = filenames.size();
+
+  // Tiles that are missing cannot win an edge, so find them first
+  std::vector<int32_t> longitude(n);
+  std::vector<int32_t> latitude(n);
+  std::vector<uint8_t> present(n);
+  for(unsigned i=0;i<n;i++)
+    {
+      struct stat st;
+      present[i] =
+	parseSRTMTileName(filenames[i], longitude[i], latitude[i]) &&
+	(stat(filenames[i].c_str(), &st) == 0);
+    }
 
-  for(unsigned y=0; y<h; y++)
+  // Edges go to the latest tile in the list that is actually read. If a
+  // tile fails to read, those that left their edges to it, or that it
+  // replaced, are read again without it, until every read succeeds.
+  std::vector<uint8_t> ok(n);
+  std::vector<uint8_t> merged(n);
+  std::vector<bool> merged_flags(9*n);
+  for(;;)
     {
-      assert(fread(data+(h-y-1)*w, sizeof(*data), w, fp) == w);
-      for(unsigned x=0;x<w;x++)data[(h-y-1)*w+x] = ntohs(data[(h-y-1)*w+x]);
+      // Neighbours of each tile later in the list; a tile that appears
+      // again later is not read at all
+      std::vector<bool> later_flags(9*n);
+      std::vector<uint8_t> wanted(present);
+      for(unsigned i=0;i<n;i++)
+	for(unsigned j=i+1;wanted[i]&&j<n;j++)
+	  {
+	    if(!present[j])continue;
+	    const int32_t dx = round(longitude[j]-longitude[i], 1);
+	    const int32_t dy = latitude[j]-latitude[i];
+	    if((dx==0)&&(dy==0))wanted[i] = false;
+	    else if((abs(dx)<=1)&&(abs(dy)<=1))
+	      later_flags[9*i+(dy+1)*3+dx+1] = true;
+	  }
+
+      std::vector<unsigned> todo;
+      for(unsigned i=0;i<n;i++)
+	if(wanted[i] &&
+	   (!merged[i] || !std::equal(later_flags.begin()+9*i,
+				      later_flags.begin()+9*i+9,
+				      merged_flags.begin()+9*i)))
+	  todo.push_back(i);
+      if(todo.empty())break;
+
+      // Tiles write disjoint samples so are read in parallel, which keeps
+      // several reads in flight and spreads the inflating of compressed
+      // tiles over the threads
+#pragma omp parallel for schedule(dynamic)
+      for(int k=0;k<int(todo.size());k++)
+	{
+	  const unsigned i = todo[k];
+	  bool later[9];
+	  std::copy(later_flags.begin()+9*i, later_flags.begin()+9*i+9, later);
+	  ok[i] = mergeFile(filenames[i], res+1, res+1,
+			    longitude[i]*res, latitude[i]*res, later);
+	}
+
+      for(unsigned k=0;k<todo.size();k++)
+	{
+	  const unsigned i = todo[k];
+	  merged[i] = 1;
+	  std::copy(later_flags.begin()+9*i, later_flags.begin()+9*i+9,
+		    merged_flags.begin()+9*i);
+	  if(!ok[i])present[i] = 0;
+	}
     }
-  fclose(fp);
 
-  return new DTEDMap(w,h,left,bottom,data,true,resolution);
+  if(loaded)loaded->assign(ok.begin(), ok.end());
+  return std::count(ok.begin(), ok.end(), 1);
 }
 
-DTEDMap* DTEDMap::loadSRTMTile(const std::string& filename,
-			       uint32_t resolution)
+bool DTEDMap::mergeSRTMTile(const std::string& filename)
 {
-  std::string basename;
-  if(filename.rfind("/") != std::string::npos)
-    basename = filename.substr(filename.rfind("/")+1);
-  else
-    basename = filename;
+  int32_t latitude = 0;
+  int32_t longitude = 0;
+  parseSRTMTileName(filename, longitude, latitude);
+  const int32_t res = int32_t(resolution());
+  return mergeMap(filename, res+1, res+1, longitude*res, latitude*res);
+}
+
+bool DTEDMap::mergeSRTMTileFromDir(const std::string& directory,
+				   int32_t left, int32_t bottom,
+				   const DTEDTileIndex* index)
+{
+  if((left<-180)||(left>179)||(bottom<-90)||(bottom>89))return false;
+  std::string filename = findSRTMTile(directory, left, bottom, index);
+  if(filename.empty())return false;
+  std::cerr << filename << ' ';
+  const int32_t res = int32_t(resolution());
+  return mergeMap(filename, res+1, res+1, left*res, bottom*res);
+}
+
+DTEDMapPtr DTEDMap::loadMap(const std::string& filename,
+			    unsigned w, unsigned h, 
+			    int32_t left, int32_t bottom, 
+			    uint32_t resolution)
+{
+  // Every sample is read from the file so skip the void fill
+  DTEDAllocator* allocator = DTEDAllocator::getDefault();
+  DTEDMapPtr map(new DTEDMap(w,h,left,bottom,allocator->allocate(w*h),
+			     true,resolution,allocator));
+  if(!map->mergeMap(filename,w,h,left,bottom))map.reset();
+  return map;
+}
 
+DTEDMapPtr DTEDMap::loadSRTMTile(const std::string& filename,
+				 uint32_t resolution)
+{
   int32_t latitude = 0;
   int32_t longitude = 0;
-  VSDataConverter::fromString(latitude, basename.substr(1,2));
-  if(basename[0]=='S')latitude = -latitude;
-  VSDataConverter::fromString(longitude, basename.substr(4,3));
-  if(basename[3]=='W')longitude = -longitude;
+  parseSRTMTileName(filename, longitude, latitude);
   
   return loadMap(filename,resolution+1,resolution+1,
 		 longitude*int32_t(resolution),latitude*int32_t(resolution),
 		 resolution);
 }
 
-DTEDMap* DTEDMap::loadSRTMTileFromDir(const std::string& directory,
-				      int32_t left, int32_t bottom,
-				      uint32_t resolution)
+DTEDMapPtr DTEDMap::loadSRTMTileFromDir(const std::string& directory,
+					int32_t left, int32_t bottom,
+					uint32_t resolution,
+					const DTEDTileIndex* index)
 {
-  char filename[12];
-  if((left<-180)||(left>179)||(bottom<-90)||(bottom>89))return 0;
-  sprintf(filename,"%c%02d%c%03d.hgt",
-	  (bottom<0)?'S':'N',abs(bottom),(left<0)?'W':'E',abs(left));
-  std::string all_filename = std::string(filename);
-  if(!directory.empty())
-    all_filename = directory + std::string("/") + std::string(filename);
-  std::cerr << all_filename << ' ';
-  return loadMap(all_filename,resolution+1,resolution+1,
+  if((left<-180)||(left>179)||(bottom<-90)||(bottom>89))return DTEDMapPtr();
+  std::string filename = findSRTMTile(directory, left, bottom, index);
+  if(filename.empty())return DTEDMapPtr();
+  std::cerr << filename << ' ';
+  return loadMap(filename,resolution+1,resolution+1,
 		 left*int32_t(resolution),bottom*int32_t(resolution),
 		 resolution);
 }
 
+DTEDMapPtr DTEDMap::loadSRTMRegionFromDir(const std::string& directory,
+					  unsigned w, unsigned h,
+					  int32_t left, int32_t bottom,
+					  uint32_t resolution,
+					  const DTEDTileIndex* index)
+{
+  const int32_t res = int32_t(resolution);
+  DTEDMapPtr map(new DTEDMap(w,h,left,bottom,resolution));
+
+  // Tiles are "res+1" samples square and share their edges with their
+  // neighbours, so only tiles that add something beyond a shared edge are
+  // loaded. Each is read straight into the region, several at once.
+  int32_t r = left+std::max(int32_t(w),2)-2;
+  int32_t t = bottom+std::max(int32_t(h),2)-2;
+  int32_t tile_l = (left>=0) ? left/res : -((-left+res-1)/res);
+  int32_t tile_b = (bottom>=0) ? bottom/res : -((-bottom+res-1)/res);
+  int32_t tile_r = (r>=0) ? r/res : -((-r+res-1)/res);
+  int32_t tile_t = (t>=0) ? t/res : -((-t+res-1)/res);
+
+  std::vector<std::string> filenames;
+  for(int32_t x = tile_l; x<=tile_r; x++)
+    for(int32_t y = tile_b; y<=tile_t; y++)
+      if((y>=-90)&&(y<=89))
+	{
+	  std::string filename = findSRTMTile(directory,round(x,1),y,index);
+	  if(!filename.empty())filenames.push_back(filename);
+	}
+
+  std::vector<bool> loaded;
+  map->mergeSRTMTiles(filenames, &loaded);
+  for(unsigned i=0;i<filenames.size();i++)
+    if(loaded[i])std::cerr << filenames[i] << ' ';
+
+  return map;
+}
+
+std::string DTEDMap::srtmTileName(const std::string& directory,
+				  int32_t left, int32_t bottom)
+{
+  char filename[32];
+  snprintf(filename,sizeof(filename),"%c%02d%c%03d.hgt",
+	   (bottom<0)?'S':'N',abs(bottom),(left<0)?'W':'E',abs(left));
+  if(directory.empty())return std::string(filename);
+  return directory + std::string("/") + std::string(filename);
+}
+
+std::string DTEDMap::findSRTMTile(const std::string& directory,
+				  int32_t left, int32_t bottom,
+				  const DTEDTileIndex* index)
+{
+  if(index && index->valid())
+    {
+      const DTEDTileSummary* tile = index->find(left, bottom);
+      if(!tile)return std::string();
+      if(directory.empty())return tile->fFilename;
+      return directory + std::string("/") + tile->fFilename;
+    }
+
+  // Prefer the raw tile, then the gzipped and zipped forms
+  const std::string filename = srtmTileName(directory, left, bottom);
+  const char* suffix[] = { "", ".gz", ".zip" };
+  for(unsigned i=0;i<sizeof(suffix)/sizeof(*suffix);i++)
+    {
+      struct stat st;
+      std::string path = filename + std::string(suffix[i]);
+      if(stat(path.c_str(), &st) == 0)return path;
+    }
+  return std::string();
+}
+
+bool DTEDMap::parseSRTMTileName(const std::string& filename,
+				int32_t& longitude, int32_t& latitude)
+{
+  std::string basename;
+  if(filename.rfind("/") != std::string::npos)
+    basename = filename.substr(filename.rfind("/")+1);
+  else
+    basename = filename;
+
+  // Names are of the form N34W119.hgt, N34W119.hgt.gz or N34W119.hgt.zip
+  if((basename.size()<11)||(basename.substr(7,4)!=".hgt")||
+     ((basename.size()>11)&&(basename.substr(11)!=".gz")&&
+      (basename.substr(11)!=".zip"))||
+     ((basename[0]!='N')&&(basename[0]!='S'))||
+     ((basename[3]!='E')&&(basename[3]!='W')))
+    return false;
+
+  latitude = 0;
+  longitude = 0;
+  VSDataConverter::fromString(latitude, basename.substr(1,2));
+  if(basename[0]=='S')latitude = -latitude;
+  VSDataConverter::fromString(longitude, basename.substr(4,3));
+  if(basename[3]=='W')longitude = -longitude;
+  return true;
+}
+
 // ----------------------------------------------------------------------------
 // DTED Database
 // ----------------------------------------------------------------------------
@@ -146,7 +490,21 @@ DTEDDb::~DTEDDb()
   // nothing to see here
 }
 
-void DTEDDb::createTables()
+int DTEDDb::loadMapViaFile(const DTEDView& map, const std::string)
+{
+  return insertMap(map);
+}
+
+// ----------------------------------------------------------------------------
+// DTED SQL Database
+// ----------------------------------------------------------------------------
+
+DTEDSQLDb::~DTEDSQLDb()
+{
+  // nothing to see here
+}
+
+void DTEDSQLDb::createTables()
 {
   VSDBParameterTable parameter_table(fDB);
   parameter_table.createParameterTable();
@@ -162,7 +520,7 @@ void DTEDDb::createTables()
 		   VSDatabase::FLAG_NO_ERROR_ON_EXIST_OR_NOT_EXIST);  
 }
 
-void DTEDDb::setParameters(const DTEDParameters& parameters)
+void DTEDSQLDb::setParameters(const DTEDParameters& parameters)
 {
   VSDBParameterTable parameter_table(fDB);
   VSDBParameterSet parameter_set;
@@ -185,7 +543,7 @@ void DTEDDb::setParameters(const DTEDParameters& parameters)
   parameter_table.storeParameterSet(DTEDDB_PARAMTER_COLLECTION, parameter_set);
 }
 
-void DTEDDb::getParameters(DTEDParameters& parameters)
+void DTEDSQLDb::getParameters(DTEDParameters& parameters)
 {
   VSDBParameterTable parameter_table(fDB);
   VSDBParameterSet parameter_set;
@@ -203,7 +561,8 @@ void DTEDDb::getParameters(DTEDParameters& parameters)
 			      parameter_set["VoidValue"]);
 }
 
-int DTEDDb::loadMapViaFile(const DTEDMap& map, const std::string filename)
+int DTEDSQLDb::loadMapViaFile(const DTEDView& map,
+			      const std::string filename)
 {
   getParameters(fParameters);
 
@@ -234,7 +593,7 @@ int DTEDDb::loadMapViaFile(const DTEDMap& map, const std::string filename)
   return c;
 }
 
-int DTEDDb::insertMap(const DTEDMap& map)
+int DTEDSQLDb::insertMap(const DTEDView& map)
 {
   if(fStmtInsert.get() == 0)
     {
@@ -265,7 +624,7 @@ int DTEDDb::insertMap(const DTEDMap& map)
   return count;
 }
 
-int DTEDDb::retrieveMap(DTEDMap& map)
+int DTEDSQLDb::retrieveMap(DTEDMap& map)
 {
   if(fStmtSelect.get() == 0)
     {
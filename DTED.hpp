@@ -17,15 +17,22 @@
 #define DTED_HPP
 
 #include <string>
+#include <vector>
 #include <memory>
+#include <cassert>
+#include <stdexcept>
 #include <stdint.h>
 
 #include <VSDatabase.hpp>
 
+#include "DTEDAllocator.hpp"
+
 //! VERITAS namespace
 namespace VERITAS 
 {
 
+  class DTEDTileIndex;
+
   class DTEDData
   {
   public:
@@ -44,23 +51,197 @@ namespace VERITAS
     int16_t     fVoidValue;
   };
 
+  class DTEDMap;
+
+  //! Non-owning read-only window on the samples of a map. Rows are stride
+  //! samples apart, so a view can reference any rectangle of a map or
+  //! mosaic without copying. The view must not outlive the map.
+  class DTEDView
+  {
+  public:
+    DTEDView(): fData(), fStride(), fWidth(), fHeight(), fLeft(), fBottom(),
+		fResolution(1200) { }
+    DTEDView(const int16_t* data, unsigned w, unsigned h, unsigned stride,
+	     int32_t left, int32_t bottom, uint32_t resolution = 1200)
+      : fData(data), fStride(stride), fWidth(w), fHeight(h),
+	fLeft(round(left,resolution)), fBottom(bottom),
+	fResolution(resolution) { }
+    //! All of a map, which must be in rows; a blocked map throws
+    //! std::logic_error (see DTEDMap)
+    DTEDView(const DTEDMap& map);
+
+    unsigned width() const { return fWidth; }
+    unsigned height() const { return fHeight; }
+    unsigned stride() const { return fStride; }
+
+    int32_t left() const { return fLeft; }
+    int32_t right() const { return fLeft+fWidth; }
+    int32_t bottom() const { return fBottom; }
+    int32_t top() const { return fBottom+fHeight; }
+
+    const int16_t* data() const { return fData; }
+    const int16_t* row(unsigned y) const
+    { assert(y<fHeight); return fData+y*fStride; }
+
+    const int16_t& datum(unsigned x, unsigned y) const 
+    { assert((x<fWidth)&&(y<fHeight)); return fData[y*fStride+x]; }
+    const int16_t& operator() (unsigned x, unsigned y) const 
+    { return datum(x,y); }
+
+    uint32_t resolution() const { return fResolution; }
+
+    static int32_t round(int32_t x, uint32_t resolution)
+    {
+      int32_t wrap = 360 * int32_t(resolution);
+      x = ((x%wrap)+wrap)%wrap;
+      if(x>=wrap/2)x-=wrap;
+      return x;
+    }
+
+    int32_t round(int32_t x) const { return round(x,fResolution); }
+      
+    int32_t xOf(int32_t x) const { return round(x-left()-width()/2)+width()/2;}
+    int32_t yOf(int32_t y) const { return y-bottom(); }
+
+    int32_t xCoordOf(int32_t x) const { return round(x+left()); }
+    int32_t yCoordOf(int32_t y) const { return y+bottom(); }
+
+    //! Sub-window of w x h samples with bottom-left corner at pixel (x,y)
+    DTEDView window(unsigned x, unsigned y, unsigned w, unsigned h) const
+    {
+      assert((x+w<=fWidth)&&(y+h<=fHeight));
+      return DTEDView(fData+y*fStride+x, w, h, fStride,
+		      xCoordOf(x), yCoordOf(y), fResolution);
+    }
+
+  private:
+    const int16_t* fData;
+    unsigned       fStride;
+    unsigned       fWidth;
+    unsigned       fHeight;
+    int32_t        fLeft;
+    int32_t        fBottom;
+    uint32_t       fResolution;
+  };
+
+  typedef std::unique_ptr<DTEDMap> DTEDMapPtr;
+
+  //! Map that owns its samples. Maps can be moved but not copied; use
+  //! view() or window() to pass all or part of one to the kernels.
+  //!
+  //! Samples are stored in rows (L_ROWS), or in 64x64 blocks (L_BLOCKS)
+  //! each stored in rows, with the blocks in Z-order so that neighbouring
+  //! blocks are mostly close in memory. A stencil working through a
+  //! blocked map block by block touches a few pages rather than one per
+  //! row. The layout is chosen on construction; use convert() to change
+  //! it.
+  //!
+  //! A blocked map can be filled, merged into, read from a DTEDDb and
+  //! accessed with datum(), index() and block(), but it cannot be viewed:
+  //! view(), window() and the DTEDView constructor throw std::logic_error.
+  //! Views are a pointer and a row stride so that the kernels' inner
+  //! loops have no layout to test, so every kernel taking a DTEDView
+  //! (statistics, contours, horizons, resampling, rendering) needs a map
+  //! in rows, and a blocked one must be converted, which copies it.
   class DTEDMap
   {
   public:
+    enum Layout { L_ROWS, L_BLOCKS };
+    enum { BLOCK_BITS = 6, BLOCK_SIZE = 1<<BLOCK_BITS,
+	   BLOCK_MASK = BLOCK_SIZE-1, BLOCK_SAMPLES = BLOCK_SIZE*BLOCK_SIZE };
+
     DTEDMap(unsigned w, unsigned h, int32_t left, int32_t bottom, 
-	    uint32_t resolution = 1200, int16_t zero_val = -32768)
+	    uint32_t resolution = 1200, int16_t zero_val = -32768,
+	    DTEDAllocator* allocator = 0, Layout layout = L_ROWS)
       : fResolution(resolution),
-	fData(new int16_t[w*h]), fMine(true), fWidth(w), fHeight(h),
-	fLeft(round(left)), fBottom(round(bottom))
+	fAllocator(allocator?allocator:DTEDAllocator::getDefault()),
+	fData(), fWidth(w), fHeight(h),
+	fLeft(round(left)), fBottom(round(bottom)), fLayout(layout),
+	fBlocksX(), fBlockOffset()
     { 
-      for(unsigned i=0;i<w*h;i++)fData[i]=zero_val;
+      if(layout == L_BLOCKS)setBlockOffsets();
+      fData = fAllocator->allocate(size());
+      fill(zero_val);
     }
+    //! Wrap existing data. If mine is set the map takes ownership and
+    //! frees it through allocator (default: delete[]).
     DTEDMap(unsigned w, unsigned h, int32_t left, int32_t bottom,
-	    int16_t* data, bool mine=false, uint32_t resolution = 1200)
+	    int16_t* data, bool mine=false, uint32_t resolution = 1200,
+	    DTEDAllocator* allocator = 0)
       : fResolution(resolution),
-	fData(data), fMine(mine), fWidth(w), fHeight(h),
-	fLeft(round(left)), fBottom(round(bottom))  { }
-    ~DTEDMap() { if(fMine)delete[] fData; }
+	fAllocator(mine?(allocator?allocator:DTEDAllocator::heap()):0),
+	fData(data), fWidth(w), fHeight(h),
+	fLeft(round(left)), fBottom(round(bottom)), fLayout(L_ROWS),
+	fBlocksX(), fBlockOffset()  { }
+    DTEDMap(DTEDMap&& o)
+      : fResolution(o.fResolution), fAllocator(o.fAllocator), fData(o.fData),
+	fWidth(o.fWidth), fHeight(o.fHeight),
+	fLeft(o.fLeft), fBottom(o.fBottom), fLayout(o.fLayout),
+	fBlocksX(o.fBlocksX), fBlockOffset(std::move(o.fBlockOffset))
+    {
+      o.fAllocator = 0;
+      o.fData = 0;
+      o.fWidth = o.fHeight = 0;
+      o.fLayout = L_ROWS;
+      o.fBlocksX = 0;
+      o.fBlockOffset.clear();
+    }
+    DTEDMap& operator= (DTEDMap&& o)
+    {
+      if(&o == this)return *this;
+      release();
+      fResolution  = o.fResolution;
+      fAllocator   = o.fAllocator;
+      fData        = o.fData;
+      fWidth       = o.fWidth;
+      fHeight      = o.fHeight;
+      fLeft        = o.fLeft;
+      fBottom      = o.fBottom;
+      fLayout      = o.fLayout;
+      fBlocksX     = o.fBlocksX;
+      fBlockOffset = std::move(o.fBlockOffset);
+      o.fAllocator = 0;
+      o.fData = 0;
+      o.fWidth = o.fHeight = 0;
+      o.fLayout = L_ROWS;
+      o.fBlocksX = 0;
+      o.fBlockOffset.clear();
+      return *this;
+    }
+    DTEDMap(const DTEDMap&) = delete;
+    DTEDMap& operator= (const DTEDMap&) = delete;
+    ~DTEDMap() { release(); }
+
+    Layout layout() const { return fLayout; }
+    //! Number of samples stored, including the padding of edge blocks
+    size_t size() const
+    { return (fLayout==L_ROWS) ? size_t(fWidth)*size_t(fHeight) :
+	fBlockOffset.size()*size_t(BLOCK_SAMPLES); }
+
+    //! Position of sample (x,y) in data()
+    size_t index(unsigned x, unsigned y) const
+    {
+      assert((x<fWidth)&&(y<fHeight));
+      if(fLayout == L_ROWS)return size_t(y)*size_t(fWidth)+x;
+      return fBlockOffset[(y>>BLOCK_BITS)*fBlocksX+(x>>BLOCK_BITS)] +
+	(size_t(y&BLOCK_MASK)<<BLOCK_BITS) + (x&BLOCK_MASK);
+    }
+
+    //! First sample of the block holding (x,y) in a blocked map; its rows
+    //! are BLOCK_SIZE samples apart
+    const int16_t* block(unsigned x, unsigned y) const
+    {
+      assert(fLayout == L_BLOCKS);
+      return fData+fBlockOffset[(y>>BLOCK_BITS)*fBlocksX+(x>>BLOCK_BITS)];
+    }
+
+    //! Copy of the map in the given layout
+    DTEDMapPtr convert(Layout layout, DTEDAllocator* allocator = 0) const;
+
+    //! Set every sample. Large maps are filled by the threads in the same
+    //! row bands the kernels use, so that on first touch each band is
+    //! placed on the NUMA node of the thread that will work on it.
+    void fill(int16_t value);
 
     unsigned width() const { return fWidth; }
     unsigned height() const { return fHeight; }
@@ -74,9 +255,9 @@ namespace VERITAS
     const int16_t* data() const { return fData; }
 
     int16_t& datum(unsigned x, unsigned y) 
-    { assert((x<fWidth)&&(y<fHeight)); return fData[y*fWidth+x]; }
+    { return fData[index(x,y)]; }
     const int16_t& datum(unsigned x, unsigned y) const 
-    { assert((x<fWidth)&&(y<fHeight)); return fData[y*fWidth+x]; }
+    { return fData[index(x,y)]; }
 
     int16_t& operator() (unsigned x, unsigned y) 
     { return datum(x,y); }
@@ -86,12 +267,7 @@ namespace VERITAS
     uint32_t resolution() const { return fResolution; }
 
     static int32_t round(int32_t x, uint32_t resolution)
-    {
-      int32_t wrap = 360 * int32_t(resolution);
-      x = ((x%wrap)+wrap)%wrap;
-      if(x>=wrap/2)x-=wrap;
-      return x;
-    }
+    { return DTEDView::round(x, resolution); }
 
     int32_t round(int32_t x) const { return round(x,fResolution); }
       
@@ -101,53 +277,133 @@ namespace VERITAS
     int32_t xCoordOf(int32_t x) const { return round(x+left()); }
     int32_t yCoordOf(int32_t y) const { return y+bottom(); }
 
-    void merge(const DTEDMap& map);
-
-    static DTEDMap* loadMap(const std::string& filename,
-			    unsigned w, unsigned h, 
-			    int32_t left, int32_t bottom, 
-			    uint32_t resolution = 1200);
-    static DTEDMap* loadSRTMTile(const std::string& filename,
-				 uint32_t resolution = 1200);
-    static DTEDMap* loadSRTMTileFromDir(const std::string& directory,
-					int32_t left, int32_t bottom,
-					uint32_t resolution = 1200);
+    //! View of the samples, which must be in rows. A blocked map cannot
+    //! be viewed, in any build, and throws std::logic_error; convert()
+    //! it to rows first. window() likewise.
+    DTEDView view() const
+    { if(fLayout != L_ROWS)
+	throw std::logic_error("DTEDMap: blocked map used as a view, "
+			       "convert it to rows first");
+      return DTEDView(fData, fWidth, fHeight, fWidth,
+		      fLeft, fBottom, fResolution); }
+    DTEDView window(unsigned x, unsigned y, unsigned w, unsigned h) const
+    { return view().window(x,y,w,h); }
+
+    //! Copy the overlapping part of another map or view into this one
+    void merge(const DTEDView& map);
+
+    //! Read the overlapping part of a w x h big-endian map file directly
+    //! into this one. The file may be gzipped or zipped, in which case it
+    //! is inflated as it is read. Returns false if the file cannot be read.
+    bool mergeMap(const std::string& filename,
+		  unsigned w, unsigned h, int32_t left, int32_t bottom);
+    //! Read a list of SRTM tiles into this map, several at once. Where
+    //! tiles share an edge the one later in the list wins, as if each had
+    //! been merged in turn; tiles that cannot be read are passed over, so
+    //! their edges go to the latest tile that was. Returns the number of
+    //! tiles read, and sets loaded (if given) for each tile in the list.
+    unsigned mergeSRTMTiles(const std::vector<std::string>& filenames,
+			    std::vector<bool>* loaded = 0);
+    bool mergeSRTMTile(const std::string& filename);
+    bool mergeSRTMTileFromDir(const std::string& directory,
+			      int32_t left, int32_t bottom,
+			      const DTEDTileIndex* index = 0);
+
+    static DTEDMapPtr loadMap(const std::string& filename,
+			      unsigned w, unsigned h, 
+			      int32_t left, int32_t bottom, 
+			      uint32_t resolution = 1200);
+    static DTEDMapPtr loadSRTMTile(const std::string& filename,
+				   uint32_t resolution = 1200);
+    static DTEDMapPtr loadSRTMTileFromDir(const std::string& directory,
+					  int32_t left, int32_t bottom,
+					  uint32_t resolution = 1200,
+					  const DTEDTileIndex* index = 0);
+    static DTEDMapPtr loadSRTMRegionFromDir(const std::string& directory,
+					    unsigned w, unsigned h,
+					    int32_t left, int32_t bottom,
+					    uint32_t resolution = 1200,
+					    const DTEDTileIndex* index = 0);
+
+    static bool parseSRTMTileName(const std::string& filename,
+				  int32_t& longitude, int32_t& latitude);
+    static std::string srtmTileName(const std::string& directory,
+				    int32_t left, int32_t bottom);
+    //! Path of the tile in the directory, raw or compressed, from the
+    //! index if it is valid or by probing; empty if there is none
+    static std::string findSRTMTile(const std::string& directory,
+				    int32_t left, int32_t bottom,
+				    const DTEDTileIndex* index = 0);
     
   private:
-    uint32_t     fResolution;
-    int16_t*     fData;
-    bool         fMine;
-    unsigned     fWidth;
-    unsigned     fHeight;
-    int32_t      fLeft;
-    int32_t      fBottom;
+    void release()
+    { if(fAllocator)fAllocator->deallocate(fData,size()); }
+    void setBlockOffsets();
+    //! mergeMap, leaving samples on edges and corners of the file that
+    //! later[(dy+1)*3+dx+1] says a later tile at (dx,dy) also covers
+    bool mergeFile(const std::string& filename,
+		   unsigned w, unsigned h, int32_t left, int32_t bottom,
+		   const bool* later);
+
+    uint32_t       fResolution;
+    DTEDAllocator* fAllocator;   //!< 0 if data is not owned
+    int16_t*       fData;
+    unsigned       fWidth;
+    unsigned       fHeight;
+    int32_t        fLeft;
+    int32_t        fBottom;
+    Layout         fLayout;
+    unsigned       fBlocksX;
+    std::vector<uint32_t> fBlockOffset;  //!< of each block, in rows of blocks
   };
 
+  inline DTEDView::DTEDView(const DTEDMap& map): DTEDView(map.view()) { }
+
 #define DTEDDB_PARAMTER_COLLECTION "DTED"
 #define DTEDDB_DATA_TABLE          "Elevation"
 
+  //! Storage backend for elevation data. Maps are stored and retrieved
+  //! by their sample coordinates; longitudes wrap at the antimeridian.
   class DTEDDb
   {
   public:
-    DTEDDb(VSDatabase* db): 
-      fDB(db), fStmtInsert(), fStmtSelect(), fBoundData(), fParameters() { }
     virtual ~DTEDDb();
 
-    void createTables();
-    void setParameters(const DTEDParameters& parameters);
-    void getParameters(DTEDParameters& parameters);
+    virtual void createTables() = 0;
+    virtual void setParameters(const DTEDParameters& parameters) = 0;
+    virtual void getParameters(DTEDParameters& parameters) = 0;
+    
+    //! Bulk load, if the backend has a faster path than insertMap
+    virtual int loadMapViaFile(const DTEDView& map,
+			       const std::string filename="/tmp/dted.dat");
+    virtual int insertMap(const DTEDView& map) = 0;
+    virtual int retrieveMap(DTEDMap& map) = 0;
+  };
+
+  //! Backend on a VSDatabase (MySQL) table keyed on (Longitude, Latitude)
+  class DTEDSQLDb: public DTEDDb
+  {
+  public:
+    DTEDSQLDb(VSDatabase* db): 
+      DTEDDb(), fDB(db), fStmtInsert(), fStmtSelect(), fBoundData(),
+      fParameters() { }
+    virtual ~DTEDSQLDb();
+
+    virtual void createTables();
+    virtual void setParameters(const DTEDParameters& parameters);
+    virtual void getParameters(DTEDParameters& parameters);
     
-    int loadMapViaFile(const DTEDMap& map,
-		       const std::string filename="/tmp/dted.dat");
-    int insertMap(const DTEDMap& map);
-    int retrieveMap(DTEDMap& map);
+    virtual int loadMapViaFile(const DTEDView& map,
+			       const std::string filename="/tmp/dted.dat");
+    virtual int insertMap(const DTEDView& map);
+    virtual int retrieveMap(DTEDMap& map);
 
   private:
-    VSDatabase*                  fDB;
-    std::auto_ptr<VSDBStatement> fStmtInsert; 
-    std::auto_ptr<VSDBStatement> fStmtSelect; 
-    DTEDData                     fBoundData;
-    DTEDParameters               fParameters;
+    VSDatabase*                    fDB;
+    std::unique_ptr<VSDBStatement> fStmtInsert; 
+    std::unique_ptr<VSDBStatement> fStmtSelect; 
+    DTEDData                       fBoundData;
+    DTEDParameters                 fParameters;
   };
 
 }
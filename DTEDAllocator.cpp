@@ -0,0 +1,266 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file DTEDAllocator.cpp
+
+  Allocators for DTED map sample storage
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#include <new>
+#include <cassert>
+#include <algorithm>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "DTEDAllocator.hpp"
+
+using namespace VERITAS;
+
+namespace
+{
+  const size_t HUGE_PAGE_SIZE = size_t(2)<<20;
+
+  // Scoped mutex lock
+  class Lock
+  {
+  public:
+    Lock(pthread_mutex_t& mutex): fMutex(mutex)
+    { pthread_mutex_lock(&fMutex); }
+    ~Lock() { pthread_mutex_unlock(&fMutex); }
+  private:
+    pthread_mutex_t& fMutex;
+  };
+
+  void noteAllocation(DTEDAllocatorStats& stats, size_t bytes)
+  {
+    stats.fAllocations++;
+    stats.fBytesInUse += bytes;
+    stats.fBytesPeak = std::max(stats.fBytesPeak, stats.fBytesInUse);
+  }
+
+  void noteDeallocation(DTEDAllocatorStats& stats, size_t bytes)
+  {
+    // Maps may adopt buffers that were not allocated through us
+    stats.fDeallocations++;
+    stats.fBytesInUse -= std::min(stats.fBytesInUse, uint64_t(bytes));
+  }
+}
+
+// ----------------------------------------------------------------------------
+// DTED Allocator Stats
+// ----------------------------------------------------------------------------
+
+void DTEDAllocatorStats::print(std::ostream& stream) const
+{
+  stream << "Allocations:   " << fAllocations << std::endl
+	 << "Deallocations: " << fDeallocations << std::endl
+	 << "Pool hits:     " << fPoolHits << std::endl
+	 << "Huge pages:    " << fHugePageMaps << " hugetlb, "
+	 << fTHPMaps << " transparent" << std::endl
+	 << "Bytes in use:  " << fBytesInUse << std::endl
+	 << "Peak bytes:    " << fBytesPeak << std::endl
+	 << "Pooled bytes:  " << fBytesPooled << std::endl;
+}
+
+// ----------------------------------------------------------------------------
+// DTED Allocator
+// ----------------------------------------------------------------------------
+
+DTEDAllocator* DTEDAllocator::sDefault = 0;
+
+DTEDAllocator::~DTEDAllocator()
+{
+  // nothing to see here
+}
+
+DTEDAllocator* DTEDAllocator::getDefault()
+{
+  if(sDefault)return sDefault;
+  return heap();
+}
+
+void DTEDAllocator::setDefault(DTEDAllocator* allocator)
+{
+  sDefault = allocator;
+}
+
+DTEDAllocator* DTEDAllocator::heap()
+{
+  static DTEDHeapAllocator allocator;
+  return &allocator;
+}
+
+// ----------------------------------------------------------------------------
+// DTED Heap Allocator
+// ----------------------------------------------------------------------------
+
+DTEDHeapAllocator::DTEDHeapAllocator(): DTEDAllocator(), fMutex(), fStats()
+{
+  pthread_mutex_init(&fMutex, 0);
+}
+
+DTEDHeapAllocator::~DTEDHeapAllocator()
+{
+  pthread_mutex_destroy(&fMutex);
+}
+
+int16_t* DTEDHeapAllocator::allocate(size_t n)
+{
+  int16_t* p = new int16_t[n];
+  Lock lock(fMutex);
+  noteAllocation(fStats, n*sizeof(*p));
+  return p;
+}
+
+void DTEDHeapAllocator::deallocate(int16_t* p, size_t n)
+{
+  delete[] p;
+  Lock lock(fMutex);
+  noteDeallocation(fStats, n*sizeof(*p));
+}
+
+DTEDAllocatorStats DTEDHeapAllocator::stats() const
+{
+  Lock lock(fMutex);
+  return fStats;
+}
+
+// ----------------------------------------------------------------------------
+// DTED Pool Allocator
+// ----------------------------------------------------------------------------
+
+DTEDPoolAllocator::DTEDPoolAllocator(bool huge_pages, size_t max_pooled_bytes):
+  DTEDAllocator(), fHugePages(huge_pages), fMaxPooledBytes(max_pooled_bytes),
+  fMutex(), fPool(), fStats()
+{
+  pthread_mutex_init(&fMutex, 0);
+}
+
+DTEDPoolAllocator::~DTEDPoolAllocator()
+{
+  release();
+  pthread_mutex_destroy(&fMutex);
+}
+
+size_t DTEDPoolAllocator::roundedSize(size_t n) const
+{
+  size_t unit = fHugePages ? HUGE_PAGE_SIZE : size_t(sysconf(_SC_PAGESIZE));
+  size_t bytes = std::max(n*sizeof(int16_t), size_t(1));
+  return (bytes+unit-1)/unit*unit;
+}
+
+void* DTEDPoolAllocator::mapFresh(size_t bytes, Backing& backing) const
+{
+  backing = B_PAGES;
+  if(fHugePages)
+    {
+#ifdef MAP_HUGETLB
+      void* p = mmap(0, bytes, PROT_READ|PROT_WRITE,
+		     MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+      if(p != MAP_FAILED)
+	{
+	  backing = B_HUGETLB;
+	  return p;
+	}
+#endif
+
+      // No reserved huge pages: over-map to get a 2MB aligned region that
+      // transparent huge pages can back, and trim the excess
+      size_t over = bytes + HUGE_PAGE_SIZE;
+      char* q = static_cast<char*>(mmap(0, over, PROT_READ|PROT_WRITE,
+					MAP_PRIVATE|MAP_ANONYMOUS, -1, 0));
+      if(q == MAP_FAILED)throw std::bad_alloc();
+      char* aligned = reinterpret_cast<char*>
+	((reinterpret_cast<uintptr_t>(q)+HUGE_PAGE_SIZE-1)
+	 & ~uintptr_t(HUGE_PAGE_SIZE-1));
+      if(aligned > q)munmap(q, aligned-q);
+      if(q+over > aligned+bytes)
+	munmap(aligned+bytes, q+over-(aligned+bytes));
+#ifdef MADV_HUGEPAGE
+      if(madvise(aligned, bytes, MADV_HUGEPAGE) == 0)backing = B_THP;
+#endif
+      return aligned;
+    }
+
+  void* p = mmap(0, bytes, PROT_READ|PROT_WRITE,
+		 MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+  if(p == MAP_FAILED)throw std::bad_alloc();
+  return p;
+}
+
+int16_t* DTEDPoolAllocator::allocate(size_t n)
+{
+  size_t bytes = roundedSize(n);
+
+  {
+    Lock lock(fMutex);
+    std::multimap<size_t, void*>::iterator i = fPool.find(bytes);
+    if(i != fPool.end())
+      {
+	void* p = i->second;
+	fPool.erase(i);
+	noteAllocation(fStats, bytes);
+	fStats.fPoolHits++;
+	fStats.fBytesPooled -= bytes;
+	return static_cast<int16_t*>(p);
+      }
+  }
+
+  // Mapping and faulting in a fresh buffer is slow, so other threads may
+  // use the pool meanwhile
+  Backing backing;
+  void* p = mapFresh(bytes, backing);
+
+  Lock lock(fMutex);
+  noteAllocation(fStats, bytes);
+  if(backing == B_HUGETLB)fStats.fHugePageMaps++;
+  else if(backing == B_THP)fStats.fTHPMaps++;
+  return static_cast<int16_t*>(p);
+}
+
+void DTEDPoolAllocator::deallocate(int16_t* p, size_t n)
+{
+  if(p == 0)return;
+  size_t bytes = roundedSize(n);
+
+  {
+    Lock lock(fMutex);
+    noteDeallocation(fStats, bytes);
+    if(fStats.fBytesPooled + bytes <= fMaxPooledBytes)
+      {
+	fPool.insert(std::make_pair(bytes, static_cast<void*>(p)));
+	fStats.fBytesPooled += bytes;
+	return;
+      }
+  }
+
+  munmap(p, bytes);
+}
+
+DTEDAllocatorStats DTEDPoolAllocator::stats() const
+{
+  Lock lock(fMutex);
+  return fStats;
+}
+
+void DTEDPoolAllocator::release()
+{
+  std::multimap<size_t, void*> pool;
+  {
+    Lock lock(fMutex);
+    pool.swap(fPool);
+    fStats.fBytesPooled = 0;
+  }
+
+  for(std::multimap<size_t, void*>::iterator i = pool.begin();
+      i != pool.end(); i++)
+    munmap(i->second, i->first);
+}
@@ -0,0 +1,119 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file DTEDAllocator.hpp
+
+  Allocators for DTED map sample storage
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#ifndef DTEDALLOCATOR_HPP
+#define DTEDALLOCATOR_HPP
+
+#include <map>
+#include <iostream>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+//! VERITAS namespace
+namespace VERITAS
+{
+
+  class DTEDAllocatorStats
+  {
+  public:
+    DTEDAllocatorStats():
+      fAllocations(), fDeallocations(), fPoolHits(), fHugePageMaps(),
+      fTHPMaps(), fBytesInUse(), fBytesPeak(), fBytesPooled() { }
+
+    void print(std::ostream& stream) const;
+
+    uint64_t fAllocations;
+    uint64_t fDeallocations;
+    uint64_t fPoolHits;       //!< allocations satisfied from the pool
+    uint64_t fHugePageMaps;   //!< fresh buffers mapped with MAP_HUGETLB
+    uint64_t fTHPMaps;        //!< fresh buffers advised MADV_HUGEPAGE
+    uint64_t fBytesInUse;
+    uint64_t fBytesPeak;
+    uint64_t fBytesPooled;    //!< held in the pool, not in use
+  };
+
+  //! Interface for allocating the samples of a DTEDMap. Maps remember the
+  //! allocator they were created with, so the default can be changed at
+  //! any time. Allocators must outlive the maps that use them.
+  class DTEDAllocator
+  {
+  public:
+    virtual ~DTEDAllocator();
+    virtual int16_t* allocate(size_t n) = 0;
+    virtual void deallocate(int16_t* p, size_t n) = 0;
+    virtual DTEDAllocatorStats stats() const = 0;
+
+    //! Allocator used by maps and loaders when none is given
+    static DTEDAllocator* getDefault();
+    static void setDefault(DTEDAllocator* allocator);
+    //! Plain new[] / delete[]
+    static DTEDAllocator* heap();
+
+  private:
+    static DTEDAllocator* sDefault;
+  };
+
+  class DTEDHeapAllocator: public DTEDAllocator
+  {
+  public:
+    DTEDHeapAllocator();
+    virtual ~DTEDHeapAllocator();
+    virtual int16_t* allocate(size_t n);
+    virtual void deallocate(int16_t* p, size_t n);
+    virtual DTEDAllocatorStats stats() const;
+  private:
+    mutable pthread_mutex_t fMutex;
+    DTEDAllocatorStats      fStats;
+  };
+
+  //! Recycles buffers of the same (rounded) size rather than returning
+  //! them to the system, so repeated tile-sized maps reuse memory that is
+  //! already faulted in. Fresh buffers are mapped on 2MB boundaries and
+  //! backed by huge pages if requested: MAP_HUGETLB first, falling back to
+  //! transparent huge pages via madvise(MADV_HUGEPAGE).
+  class DTEDPoolAllocator: public DTEDAllocator
+  {
+  public:
+    DTEDPoolAllocator(bool huge_pages = true,
+		      size_t max_pooled_bytes = size_t(1)<<30);
+    virtual ~DTEDPoolAllocator();
+    virtual int16_t* allocate(size_t n);
+    virtual void deallocate(int16_t* p, size_t n);
+    virtual DTEDAllocatorStats stats() const;
+
+    //! Return all pooled buffers to the system
+    void release();
+
+  private:
+    DTEDPoolAllocator(const DTEDPoolAllocator&);
+    DTEDPoolAllocator& operator=(const DTEDPoolAllocator&);
+
+    enum Backing { B_PAGES, B_HUGETLB, B_THP };
+
+    size_t roundedSize(size_t n) const;
+    //! Map a new buffer; called without the mutex held
+    void* mapFresh(size_t bytes, Backing& backing) const;
+
+    bool                          fHugePages;
+    size_t                        fMaxPooledBytes;
+    mutable pthread_mutex_t       fMutex;
+    std::multimap<size_t, void*>  fPool;
+    DTEDAllocatorStats            fStats;
+  };
+
+}
+
+#endif // DTEDALLOCATOR_HPP
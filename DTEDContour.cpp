@@ -0,0 +1,370 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file DTEDContour.cpp
+
+  Marching-squares contour extraction from DTED maps
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+#include <iomanip>
+
+#include "DTEDContour.hpp"
+#include "DTEDParallel.hpp"
+
+using namespace VERITAS;
+
+namespace
+{
+  const int32_t VOID = -32768;
+
+  // Segment between two crossing points on cell edges. Edges are given
+  // globally unique ids so that segments from neighbouring cells (and
+  // neighbouring row bands) can be joined by matching ids.
+  class Segment
+  {
+  public:
+    uint32_t level;
+    uint64_t edge[2];
+    float    x[2];
+    float    y[2];
+  };
+
+  // Endpoint of a segment, sortable by level and edge id
+  class Endpoint
+  {
+  public:
+    uint64_t key;
+    uint32_t end;  // 2*segment + (0|1)
+    bool operator< (const Endpoint& o) const
+    { return (key<o.key)||((key==o.key)&&(end<o.end)); }
+  };
+
+  // Corners: 0=(x,y) 1=(x+1,y) 2=(x+1,y+1) 3=(x,y+1), bit set if z>=level
+  // Edges:   0=bottom 1=right 2=top 3=left
+  // Saddles 5 and 10 are listed for "centre below"; swapped otherwise.
+  const int CASE_EDGES[16][4] = {
+    { -1,-1,-1,-1 }, {  3, 0,-1,-1 }, {  0, 1,-1,-1 }, {  3, 1,-1,-1 },
+    {  1, 2,-1,-1 }, {  3, 0, 1, 2 }, {  0, 2,-1,-1 }, {  3, 2,-1,-1 },
+    {  2, 3,-1,-1 }, {  0, 2,-1,-1 }, {  0, 1, 2, 3 }, {  1, 2,-1,-1 },
+    {  3, 1,-1,-1 }, {  0, 1,-1,-1 }, {  3, 0,-1,-1 }, { -1,-1,-1,-1 } };
+
+  void crossing(int edge, unsigned x, unsigned y, unsigned w,
+		const int32_t z[4], double level,
+		uint64_t& id, float& px, float& py)
+  {
+    const uint64_t i = uint64_t(y)*w+x;
+    double t;
+    switch(edge)
+      {
+      case 0:
+	t = (level-z[0])/double(z[1]-z[0]);
+	id = 2*i; px = float(x+t); py = float(y);
+	break;
+      case 1:
+	t = (level-z[1])/double(z[2]-z[1]);
+	id = 2*(i+1)+1; px = float(x+1); py = float(y+t);
+	break;
+      case 2:
+	t = (level-z[3])/double(z[2]-z[3]);
+	id = 2*(i+w); px = float(x+t); py = float(y+1);
+	break;
+      default:
+	t = (level-z[0])/double(z[3]-z[0]);
+	id = 2*i+1; px = float(x); py = float(y+t);
+	break;
+      }
+  }
+
+  void contourBand(const DTEDView& map, const std::vector<double>& levels,
+		   unsigned y0, unsigned y1, std::vector<Segment>& segments)
+  {
+    const unsigned w = map.width();
+    for(unsigned y=y0;y<y1;y++)
+      {
+	const int16_t* r0 = &map.datum(0,y);
+	const int16_t* r1 = &map.datum(0,y+1);
+	for(unsigned x=0;x+1<w;x++)
+	  {
+	    const int32_t z[4] = { r0[x], r0[x+1], r1[x+1], r1[x] };
+	    if((z[0]==VOID)||(z[1]==VOID)||(z[2]==VOID)||(z[3]==VOID))
+	      continue;
+
+	    const int32_t zmin = std::min(std::min(z[0],z[1]),
+					  std::min(z[2],z[3]));
+	    const int32_t zmax = std::max(std::max(z[0],z[1]),
+					  std::max(z[2],z[3]));
+
+	    // Only levels with zmin < level <= zmax cross this cell
+	    std::vector<double>::const_iterator il =
+	      std::upper_bound(levels.begin(), levels.end(), double(zmin));
+	    for(;(il!=levels.end())&&(*il<=zmax);il++)
+	      {
+		const double level = *il;
+		const unsigned c =
+		  ((z[0]>=level)?1:0) | ((z[1]>=level)?2:0) |
+		  ((z[2]>=level)?4:0) | ((z[3]>=level)?8:0);
+		const int* e = CASE_EDGES[c];
+		int saddle[4];
+		if(((c==5)||(c==10))&&(0.25*(z[0]+z[1]+z[2]+z[3])>=level))
+		  {
+		    const int* o = CASE_EDGES[15-c];
+		    std::copy(o, o+4, saddle);
+		    e = saddle;
+		  }
+		for(unsigned k=0;(k<4)&&(e[k]>=0);k+=2)
+		  {
+		    Segment s;
+		    s.level = uint32_t(il-levels.begin());
+		    crossing(e[k], x, y, w, z, level, s.edge[0], s.x[0], s.y[0]);
+		    crossing(e[k+1], x, y, w, z, level, s.edge[1], s.x[1], s.y[1]);
+		    segments.push_back(s);
+		  }
+	      }
+	  }
+      }
+  }
+}
+
+std::vector<double>
+DTEDContours::levels(double first, double last, double interval)
+{
+  std::vector<double> l;
+  assert(interval > 0);
+  for(unsigned i=0; first+i*interval<=last; i++)l.push_back(first+i*interval);
+  return l;
+}
+
+void DTEDContours::extract(const DTEDView& map,
+			   const std::vector<double>& levels)
+{
+  fLeft       = map.left();
+  fBottom     = map.bottom();
+  fResolution = map.resolution();
+  fLevels     = levels;
+  std::sort(fLevels.begin(), fLevels.end());
+  fLevels.erase(std::unique(fLevels.begin(), fLevels.end()), fLevels.end());
+  fLines.clear();
+
+  if((map.width()<2)||(map.height()<2)||fLevels.empty())return;
+
+  // --------------------------------------------------------------------------
+  // Marching squares over row bands in parallel
+  // --------------------------------------------------------------------------
+
+  std::vector<std::vector<Segment> > band_segments;
+#pragma omp parallel
+  {
+#pragma omp single
+    band_segments.resize(dtedThreadCount());
+
+    unsigned y0;
+    unsigned y1;
+    dtedThreadBand(map.height()-1, y0, y1);
+    contourBand(map, fLevels, y0, y1, band_segments[dtedThreadNum()]);
+  }
+
+  std::vector<Segment> segments;
+  for(unsigned i=0;i<band_segments.size();i++)
+    {
+      segments.insert(segments.end(),
+		      band_segments[i].begin(), band_segments[i].end());
+      std::vector<Segment>().swap(band_segments[i]);
+    }
+
+  // --------------------------------------------------------------------------
+  // Link segment endpoints that share a (level, edge) crossing point
+  // --------------------------------------------------------------------------
+
+  const unsigned nend = 2*segments.size();
+  std::vector<Endpoint> ends(nend);
+  for(unsigned i=0;i<nend;i++)
+    {
+      ends[i].key =
+	(uint64_t(segments[i/2].level)<<40) | segments[i/2].edge[i%2];
+      ends[i].end = i;
+    }
+  std::sort(ends.begin(), ends.end());
+
+  std::vector<int64_t> link(nend, -1);
+  for(unsigned i=0;i+1<nend;i++)
+    if(ends[i].key == ends[i+1].key)
+      {
+	link[ends[i].end]   = ends[i+1].end;
+	link[ends[i+1].end] = ends[i].end;
+	i++;
+      }
+  std::vector<Endpoint>().swap(ends);
+
+  // --------------------------------------------------------------------------
+  // Walk the links to build polylines
+  // --------------------------------------------------------------------------
+
+  std::vector<bool> used(segments.size(), false);
+  for(unsigned s0=0;s0<segments.size();s0++)
+    {
+      if(used[s0])continue;
+
+      // Rewind to the start of an open line (or all the way round a
+      // closed one) so that each line is walked once from one end
+      uint32_t start = 2*s0;
+      bool closed = false;
+      while(link[start] >= 0)
+	{
+	  uint32_t prev = uint32_t(link[start])^1;
+	  if(prev/2 == s0) { closed = true; break; }
+	  start = prev;
+	}
+
+      DTEDContourLine line;
+      line.fLevel  = fLevels[segments[s0].level];
+      line.fClosed = closed;
+
+      uint32_t e = start;
+      const Segment& first = segments[e/2];
+      line.fX.push_back(first.x[e%2]);
+      line.fY.push_back(first.y[e%2]);
+      for(;;)
+	{
+	  const Segment& s = segments[e/2];
+	  used[e/2] = true;
+	  e ^= 1;
+	  // Contours through a sample exactly at the level give zero-length
+	  // segments at the corner, do not repeat the point
+	  if((s.x[e%2]!=line.fX.back())||(s.y[e%2]!=line.fY.back()))
+	    {
+	      line.fX.push_back(s.x[e%2]);
+	      line.fY.push_back(s.y[e%2]);
+	    }
+	  if(link[e] < 0)break;
+	  e = uint32_t(link[e]);
+	  if(used[e/2])break;
+	}
+
+      fLines.push_back(line);
+    }
+}
+
+void DTEDContours::extractIntervals(const DTEDView& map,
+				    const std::vector<double>& intervals)
+{
+  int16_t el_min = 32767;
+  int16_t el_max = -32768;
+  for(unsigned y=0;y<map.height();y++)
+    for(unsigned x=0;x<map.width();x++)
+      if(map(x,y) != -32768)
+	{
+	  if(map(x,y)<el_min)el_min=map(x,y);
+	  if(map(x,y)>el_max)el_max=map(x,y);
+	}
+
+  std::vector<double> levels;
+  for(unsigned i=0;i<intervals.size();i++)
+    {
+      const double interval = intervals[i];
+      if((interval <= 0)||(el_max < el_min))continue;
+      std::vector<double> l =
+	DTEDContours::levels(floor(el_min/interval)*interval,
+			     ceil(el_max/interval)*interval, interval);
+      levels.insert(levels.end(), l.begin(), l.end());
+    }
+
+  extract(map, levels);
+
+  for(unsigned i=0;i<fLines.size();i++)
+    for(unsigned j=0;j<intervals.size();j++)
+      {
+	const double interval = intervals[j];
+	const double n = fLines[i].fLevel/interval;
+	if((interval > fLines[i].fInterval)&&
+	   (fabs(n-floor(n+0.5)) < 1e-6))fLines[i].fInterval = interval;
+      }
+}
+
+double DTEDContours::longitudeOf(double x) const
+{
+  double l = (double(fLeft)+x)/double(fResolution);
+  if(l >= 180.0)l -= 360.0;
+  else if(l < -180.0)l += 360.0;
+  return l;
+}
+
+double DTEDContours::latitudeOf(double y) const
+{
+  return (double(fBottom)+y)/double(fResolution);
+}
+
+void DTEDContours::writeGeoJSON(std::ostream& stream) const
+{
+  std::ios_base::fmtflags flags = stream.flags();
+  std::streamsize precision = stream.precision();
+  stream << std::fixed;
+
+  stream << "{\"type\":\"FeatureCollection\",\"features\":[";
+  for(unsigned i=0;i<fLines.size();i++)
+    {
+      const DTEDContourLine& line = fLines[i];
+      if(i)stream << ',';
+      stream << "\n{\"type\":\"Feature\",\"properties\":{\"elevation\":"
+	     << std::setprecision(1) << line.fLevel
+	     << ",\"interval\":" << line.fInterval
+	     << ",\"closed\":" << (line.fClosed?"true":"false")
+	     << "},\"geometry\":{\"type\":\"LineString\",\"coordinates\":[";
+      stream << std::setprecision(6);
+      for(unsigned j=0;j<line.fX.size();j++)
+	{
+	  if(j)stream << ',';
+	  stream << '[' << longitudeOf(line.fX[j])
+		 << ',' << latitudeOf(line.fY[j]) << ']';
+	}
+      stream << "]}}";
+    }
+  stream << "\n]}\n";
+
+  stream.flags(flags);
+  stream.precision(precision);
+}
+
+void DTEDContours::writeBinary(std::ostream& stream) const
+{
+  // Native byte order. Header: magic, map origin and resolution, line
+  // count. Each line: level, interval, closed flag, point count, then
+  // x,y pairs as float pixel offsets from the map origin.
+  const char magic[8] = { 'D','T','E','D','C','O','N','2' };
+  stream.write(magic, sizeof(magic));
+  stream.write(reinterpret_cast<const char*>(&fLeft), sizeof(fLeft));
+  stream.write(reinterpret_cast<const char*>(&fBottom), sizeof(fBottom));
+  stream.write(reinterpret_cast<const char*>(&fResolution),
+	       sizeof(fResolution));
+  uint32_t nline = fLines.size();
+  stream.write(reinterpret_cast<const char*>(&nline), sizeof(nline));
+  for(unsigned i=0;i<fLines.size();i++)
+    {
+      const DTEDContourLine& line = fLines[i];
+      float level = float(line.fLevel);
+      float interval = float(line.fInterval);
+      uint32_t closed = line.fClosed ? 1 : 0;
+      uint32_t npoint = line.fX.size();
+      stream.write(reinterpret_cast<const char*>(&level), sizeof(level));
+      stream.write(reinterpret_cast<const char*>(&interval),
+		   sizeof(interval));
+      stream.write(reinterpret_cast<const char*>(&closed), sizeof(closed));
+      stream.write(reinterpret_cast<const char*>(&npoint), sizeof(npoint));
+      for(unsigned j=0;j<npoint;j++)
+	{
+	  stream.write(reinterpret_cast<const char*>(&line.fX[j]),
+		       sizeof(float));
+	  stream.write(reinterpret_cast<const char*>(&line.fY[j]),
+		       sizeof(float));
+	}
+    }
+}
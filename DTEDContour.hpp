@@ -0,0 +1,81 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file DTEDContour.hpp
+
+  Marching-squares contour extraction from DTED maps
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#ifndef DTEDCONTOUR_HPP
+#define DTEDCONTOUR_HPP
+
+#include <vector>
+#include <iostream>
+#include <stdint.h>
+
+#include "DTED.hpp"
+
+//! VERITAS namespace
+namespace VERITAS
+{
+
+  //! One stitched contour polyline. Points are in map pixel coordinates
+  //! relative to the bottom-left of the map that was contoured.
+  class DTEDContourLine
+  {
+  public:
+    DTEDContourLine(): fLevel(), fInterval(), fClosed(), fX(), fY() { }
+    double             fLevel;
+    double             fInterval;  //!< 0 unless from extractIntervals
+    bool               fClosed;
+    std::vector<float> fX;
+    std::vector<float> fY;
+  };
+
+  class DTEDContours
+  {
+  public:
+    DTEDContours():
+      fLeft(), fBottom(), fResolution(), fLevels(), fLines() { }
+
+    //! Levels from first to last (inclusive) in steps of interval
+    static std::vector<double> levels(double first, double last,
+				      double interval);
+
+    //! Contour map at the given levels. Cells with a void corner are
+    //! skipped, so contours are left open at voids and map edges.
+    void extract(const DTEDView& map, const std::vector<double>& levels);
+
+    //! Contour map at every multiple of each interval within its range of
+    //! elevations. Each line records the largest interval its level is a
+    //! multiple of, so with 10 and 100 the 100 m lines have interval 100
+    //! and can be drawn as major contours.
+    void extractIntervals(const DTEDView& map,
+			  const std::vector<double>& intervals);
+
+    const std::vector<DTEDContourLine>& lines() const { return fLines; }
+
+    double longitudeOf(double x) const;
+    double latitudeOf(double y) const;
+
+    void writeGeoJSON(std::ostream& stream) const;
+    void writeBinary(std::ostream& stream) const;
+
+  private:
+    int32_t                      fLeft;
+    int32_t                      fBottom;
+    uint32_t                     fResolution;
+    std::vector<double>          fLevels;
+    std::vector<DTEDContourLine> fLines;
+  };
+
+}
+
+#endif // DTEDCONTOUR_HPP
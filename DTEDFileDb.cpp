@@ -0,0 +1,350 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file DTEDFileDb.cpp
+
+  Embedded DTED database in a single memory mapped file
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "DTEDFileDb.hpp"
+
+using namespace VERITAS;
+
+namespace
+{
+  const char     MAGIC[8]       = { 'D','T','E','D','B','L','K','1' };
+  const uint32_t ENDIAN_MARK    = 0x01020304;
+  const uint32_t VERSION        = 1;
+
+  const int32_t  NLONGITUDE     = 360;
+  const int32_t  NLATITUDE      = 180;
+
+  // Header, then the directory of chunk numbers (0 if absent, otherwise
+  // one more than the position of the chunk in the data area), then the
+  // chunks starting on a page boundary
+  const size_t   HEADER_SIZE    = 4096;
+  const size_t   DIRECTORY_SIZE = NLONGITUDE*NLATITUDE*sizeof(uint32_t);
+  const size_t   DATA_OFFSET    =
+    (HEADER_SIZE+DIRECTORY_SIZE+HEADER_SIZE-1)/HEADER_SIZE*HEADER_SIZE;
+
+  // Samples are stored in host byte order; the byte order word catches
+  // a file copied to a machine of the other persuasion
+  struct FileHeader
+  {
+    char     fMagic[8];
+    uint32_t fByteOrder;
+    uint32_t fVersion;
+    int32_t  fPointsPerDegree;
+    int32_t  fVoidValue;
+    int32_t  fProjection;
+    uint32_t fNChunk;
+    char     fDescription[256];
+  };
+
+  inline FileHeader* header(char* base)
+  {
+    return reinterpret_cast<FileHeader*>(base);
+  }
+
+  inline uint32_t* directory(char* base)
+  {
+    return reinterpret_cast<uint32_t*>(base+HEADER_SIZE);
+  }
+
+  inline unsigned directoryIndex(int32_t longitude, int32_t latitude)
+  {
+    return (latitude+NLATITUDE/2)*NLONGITUDE + longitude+NLONGITUDE/2;
+  }
+
+  inline int32_t floorDiv(int32_t x, int32_t d)
+  {
+    return (x>=0) ? x/d : -((-x+d-1)/d);
+  }
+}
+
+// ----------------------------------------------------------------------------
+// DTED File Database
+// ----------------------------------------------------------------------------
+
+DTEDFileDb::DTEDFileDb(const std::string& filename, bool writable):
+  DTEDDb(), fFilename(filename), fWritable(writable), fFD(-1), fBase(),
+  fSize()
+{
+  open();
+}
+
+DTEDFileDb::~DTEDFileDb()
+{
+  close();
+}
+
+bool DTEDFileDb::open()
+{
+  close();
+
+  fFD = ::open(fFilename.c_str(), fWritable ? O_RDWR : O_RDONLY);
+  if(fFD < 0)return false;
+
+  struct stat st;
+  if((fstat(fFD, &st) != 0)||(size_t(st.st_size) < DATA_OFFSET)||
+     !remap(st.st_size))
+    {
+      close();
+      return false;
+    }
+
+  const FileHeader* h = header(fBase);
+  if((memcmp(h->fMagic, MAGIC, sizeof(MAGIC)) != 0)||
+     (h->fByteOrder != ENDIAN_MARK)||(h->fVersion != VERSION)||
+     (fSize < DATA_OFFSET + h->fNChunk*chunkSamples()*sizeof(int16_t)))
+    {
+      std::cerr << fFilename << ": not a DTED database file" << std::endl;
+      close();
+      return false;
+    }
+
+  return true;
+}
+
+void DTEDFileDb::close()
+{
+  if(fBase)munmap(fBase, fSize);
+  if(fFD >= 0)::close(fFD);
+  fBase = 0;
+  fSize = 0;
+  fFD = -1;
+}
+
+bool DTEDFileDb::remap(size_t size)
+{
+  if(fBase)munmap(fBase, fSize);
+  fBase = 0;
+  fSize = 0;
+
+  void* p = mmap(0, size, PROT_READ|(fWritable?PROT_WRITE:0), MAP_SHARED,
+		 fFD, 0);
+  if(p == MAP_FAILED)return false;
+  fBase = static_cast<char*>(p);
+  fSize = size;
+  return true;
+}
+
+size_t DTEDFileDb::chunkSamples() const
+{
+  const size_t res = size_t(header(fBase)->fPointsPerDegree);
+  return res*res;
+}
+
+int16_t* DTEDFileDb::chunk(int32_t longitude, int32_t latitude) const
+{
+  if(fBase == 0)return 0;
+  uint32_t ichunk = directory(fBase)[directoryIndex(longitude, latitude)];
+  if(ichunk == 0)return 0;
+  return reinterpret_cast<int16_t*>(fBase+DATA_OFFSET) +
+    size_t(ichunk-1)*chunkSamples();
+}
+
+int16_t* DTEDFileDb::allocateChunk(int32_t longitude, int32_t latitude)
+{
+  if(fBase == 0)return 0;
+  const uint32_t nchunk = header(fBase)->fNChunk;
+  const size_t size =
+    DATA_OFFSET + size_t(nchunk+1)*chunkSamples()*sizeof(int16_t);
+  if((ftruncate(fFD, size) != 0)||!remap(size))
+    {
+      // Map the file as it was; the header still counts only the old
+      // chunks. If even that fails the database is left closed.
+      std::cerr << fFilename << ": could not extend database" << std::endl;
+      open();
+      return 0;
+    }
+
+  FileHeader* h = header(fBase);
+  int16_t* data = reinterpret_cast<int16_t*>(fBase+DATA_OFFSET) +
+    size_t(nchunk)*chunkSamples();
+  std::fill(data, data+chunkSamples(), int16_t(h->fVoidValue));
+  directory(fBase)[directoryIndex(longitude, latitude)] = nchunk+1;
+  h->fNChunk = nchunk+1;
+  return data;
+}
+
+unsigned DTEDFileDb::nDegrees() const
+{
+  return fBase ? header(fBase)->fNChunk : 0;
+}
+
+void DTEDFileDb::createTables()
+{
+  if(isOpen() || !fWritable)return;
+
+  fFD = ::open(fFilename.c_str(), O_RDWR|O_CREAT|O_TRUNC, 0666);
+  if((fFD < 0)||(ftruncate(fFD, DATA_OFFSET) != 0)||!remap(DATA_OFFSET))
+    {
+      std::cerr << fFilename << ": could not create database" << std::endl;
+      close();
+      return;
+    }
+
+  // The new file reads as zero, which is an empty directory
+  FileHeader* h = header(fBase);
+  memcpy(h->fMagic, MAGIC, sizeof(MAGIC));
+  h->fByteOrder       = ENDIAN_MARK;
+  h->fVersion         = VERSION;
+  h->fPointsPerDegree = 1200;
+  h->fVoidValue       = -32768;
+  h->fProjection      = DTEDParameters::P_UNKNOWN;
+  h->fNChunk          = 0;
+}
+
+void DTEDFileDb::setParameters(const DTEDParameters& parameters)
+{
+  if(!isOpen() || !fWritable)return;
+
+  FileHeader* h = header(fBase);
+  if((h->fNChunk)&&((h->fPointsPerDegree != parameters.fPointsPerDegree)||
+		    (h->fVoidValue != parameters.fVoidValue)))
+    {
+      std::cerr << fFilename
+		<< ": cannot change resolution or void value of a database"
+		<< " that has data" << std::endl;
+      return;
+    }
+
+  h->fPointsPerDegree = parameters.fPointsPerDegree;
+  h->fVoidValue       = parameters.fVoidValue;
+  h->fProjection      = parameters.fProjection;
+  memset(h->fDescription, 0, sizeof(h->fDescription));
+  strncpy(h->fDescription, parameters.fDescription.c_str(),
+	  sizeof(h->fDescription)-1);
+}
+
+void DTEDFileDb::getParameters(DTEDParameters& parameters)
+{
+  if(!isOpen())return;
+
+  const FileHeader* h = header(fBase);
+  parameters.fDescription     = std::string(h->fDescription);
+  parameters.fProjection      = DTEDParameters::Projection(h->fProjection);
+  parameters.fPointsPerDegree = h->fPointsPerDegree;
+  parameters.fVoidValue       = int16_t(h->fVoidValue);
+}
+
+int DTEDFileDb::insertMap(const DTEDView& map)
+{
+  if(!isOpen() || !fWritable)return 0;
+
+  const int32_t res = header(fBase)->fPointsPerDegree;
+  const int16_t VOID = int16_t(header(fBase)->fVoidValue);
+  if(int32_t(map.resolution()) != res)
+    {
+      std::cerr << fFilename << ": map resolution " << map.resolution()
+		<< " does not match database " << res << std::endl;
+      return 0;
+    }
+
+  // As with the SQL backend, whose inserts ignore duplicate keys, only
+  // non-void samples are written and samples already stored are kept;
+  // the count is of samples newly stored
+  int count = 0;
+  for(unsigned y=0;y<map.height();y++)
+    {
+      const int32_t lat = map.yCoordOf(y);
+      const int32_t dlat = floorDiv(lat, res);
+      if((dlat < -NLATITUDE/2)||(dlat >= NLATITUDE/2))continue;
+      const int16_t* row = map.row(y);
+
+      for(unsigned x=0;x<map.width();)
+	{
+	  const int32_t lon = map.xCoordOf(x);
+	  const int32_t dlon = floorDiv(lon, res);
+	  const unsigned col = unsigned(lon - dlon*res);
+	  const unsigned n = std::min(map.width()-x, unsigned(res)-col);
+
+	  int16_t* data = chunk(dlon, dlat);
+	  if((data == 0)&&
+	     (std::count(row+x, row+x+n, VOID) != std::ptrdiff_t(n)))
+	    {
+	      data = allocateChunk(dlon, dlat);
+	      if(data == 0)return -1;
+	    }
+	  if(data)
+	    {
+	      data += size_t(lat - dlat*res)*size_t(res) + col;
+	      for(unsigned i=0;i<n;i++)
+		if((row[x+i] != VOID)&&(data[i] == VOID))
+		  data[i] = row[x+i], count++;
+	    }
+	  x += n;
+	}
+    }
+
+  return count;
+}
+
+int DTEDFileDb::retrieveMap(DTEDMap& map)
+{
+  if(!isOpen())
+    {
+      std::fill(map.data(), map.data()+map.size(), int16_t(-32768));
+      return 0;
+    }
+
+  const int32_t res = header(fBase)->fPointsPerDegree;
+  const int16_t VOID = int16_t(header(fBase)->fVoidValue);
+  assert(int32_t(map.resolution()) == res);
+
+  // Runs are cut at chunk edges, and in a blocked map at block edges, so
+  // that each is contiguous in both
+  const unsigned run_max = (map.layout() == DTEDMap::L_ROWS) ?
+    map.width() : unsigned(DTEDMap::BLOCK_SIZE);
+
+  // Rows are independent and the chunks are read only here, so they can
+  // be copied in parallel
+  int count = 0;
+#pragma omp parallel for schedule(static) reduction(+:count)
+  for(int iy=0;iy<int(map.height());iy++)
+    {
+      const unsigned y = unsigned(iy);
+      const int32_t lat = map.yCoordOf(y);
+      const int32_t dlat = floorDiv(lat, res);
+      const bool outside = (dlat < -NLATITUDE/2)||(dlat >= NLATITUDE/2);
+
+      for(unsigned x=0;x<map.width();)
+	{
+	  const int32_t lon = map.xCoordOf(x);
+	  const int32_t dlon = floorDiv(lon, res);
+	  const unsigned col = unsigned(lon - dlon*res);
+	  const unsigned n = std::min(std::min(map.width()-x, unsigned(res)-col),
+				      run_max-(x%run_max));
+	  int16_t* row = &map.datum(x,y);
+
+	  const int16_t* data = outside ? 0 : chunk(dlon, dlat);
+	  if(data)
+	    {
+	      data += size_t(lat - dlat*res)*size_t(res) + col;
+	      std::copy(data, data+n, row);
+	      count += int(n - std::count(data, data+n, VOID));
+	    }
+	  else std::fill(row, row+n, VOID);
+	  x += n;
+	}
+    }
+
+  return count;
+}
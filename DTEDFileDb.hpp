@@ -0,0 +1,81 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file DTEDFileDb.hpp
+
+  Embedded DTED database in a single memory mapped file
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#ifndef DTEDFILEDB_HPP
+#define DTEDFILEDB_HPP
+
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "DTED.hpp"
+
+//! VERITAS namespace
+namespace VERITAS
+{
+
+  //! DTEDDb backend that needs no server. The file holds a header with
+  //! the parameters, a dense directory with one entry per square degree
+  //! and the samples of each degree that has data as one contiguous
+  //! row-major chunk, allocated as maps are inserted. The whole file is
+  //! mapped, so a region read is a copy of a few rows from each degree
+  //! it covers straight out of the page cache, with no per-sample lookup
+  //! and a single pass across the antimeridian.
+  class DTEDFileDb: public DTEDDb
+  {
+  public:
+    DTEDFileDb(const std::string& filename, bool writable = true);
+    virtual ~DTEDFileDb();
+
+    //! Open the file, returning false if it does not exist or is not a
+    //! valid database. Called by the constructor.
+    bool open();
+    bool isOpen() const { return fBase != 0; }
+
+    virtual void createTables();
+    virtual void setParameters(const DTEDParameters& parameters);
+    virtual void getParameters(DTEDParameters& parameters);
+
+    //! Store the non-void samples of map that are not yet stored and
+    //! return how many there were, or -1 if the file could not be grown
+    //! to hold them, after which the database may be closed
+    virtual int insertMap(const DTEDView& map);
+    virtual int retrieveMap(DTEDMap& map);
+
+    //! Number of square degrees that have data
+    unsigned nDegrees() const;
+
+  private:
+    DTEDFileDb(const DTEDFileDb&);
+    DTEDFileDb& operator=(const DTEDFileDb&);
+
+    void close();
+    bool remap(size_t size);
+    size_t chunkSamples() const;
+    int16_t* chunk(int32_t longitude, int32_t latitude) const;
+    //! Append a void chunk, 0 on failure. The file is mapped afresh, so
+    //! earlier chunk pointers are invalid; if that fails it is closed.
+    int16_t* allocateChunk(int32_t longitude, int32_t latitude);
+
+    std::string fFilename;
+    bool        fWritable;
+    int         fFD;
+    char*       fBase;
+    size_t      fSize;
+  };
+
+}
+
+#endif // DTEDFILEDB_HPP
@@ -0,0 +1,179 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file DTEDHorizon.cpp
+
+  Horizon profile, sky obstruction and viewshed around an observer
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#include <cmath>
+#include <cassert>
+#include <cstdlib>
+#include <algorithm>
+
+#include "DTEDHorizon.hpp"
+#include "DTEDParallel.hpp"
+
+using namespace VERITAS;
+
+// ----------------------------------------------------------------------------
+// DTED Horizon Profile
+// ----------------------------------------------------------------------------
+
+double DTEDHorizonProfile::obstruction(const std::vector<float>& elevation)
+{
+  // Solid angle between the horizon and elevation h in a wedge of width
+  // dphi is dphi*sin(h); the whole hemisphere is 2pi
+  if(elevation.empty())return 0;
+  double sum = 0;
+  for(unsigned i=0;i<elevation.size();i++)
+    if(elevation[i]>0)sum += sin(elevation[i]/180.0*M_PI);
+  return sum/double(elevation.size());
+}
+
+// ----------------------------------------------------------------------------
+// DTED Horizon
+// ----------------------------------------------------------------------------
+
+void DTEDHorizon::margin(double latitude_deg, uint32_t resolution,
+			 unsigned& mx, unsigned& my) const
+{
+  const double scale_y = fEarthRadius*M_PI/180.0/double(resolution);
+  const double scale_x = scale_y*cos(latitude_deg/180.0*M_PI);
+  mx = unsigned(ceil(fMaxDistance/scale_x))+1;
+  my = unsigned(ceil(fMaxDistance/scale_y))+1;
+}
+
+void DTEDHorizon::compute(const DTEDView& map, unsigned x, unsigned y,
+			  double observer_height, DTEDHorizonProfile& profile,
+			  std::vector<uint8_t>* visible) const
+{
+  const int32_t VOID = -32768;
+
+  const double latitude = double(map.yCoordOf(y))/double(map.resolution());
+  const double scale_y = fEarthRadius*M_PI/180.0/double(map.resolution());
+  const double scale_x = scale_y*cos(latitude/180.0*M_PI);
+
+  unsigned mx;
+  unsigned my;
+  margin(latitude, map.resolution(), mx, my);
+  const int32_t nx = int32_t(mx)-1;
+  const int32_t ny = int32_t(my)-1;
+
+  profile.fElevation.assign(fNAzimuth, -90.0f);
+  profile.fObstruction = 0;
+  profile.fGroundElevation = map.datum(x,y);
+  if(visible)
+    {
+      visible->assign(map.width()*map.height(), 0);
+      (*visible)[y*map.width()+x] = 1;
+    }
+  if(map.datum(x,y) == VOID)return;
+
+  const double z_obs = double(map.datum(x,y)) + observer_height;
+  const double curvature = (1.0-fRefraction)/(2.0*fEarthRadius);
+
+  // Targets on the boundary of the search rectangle in clockwise order
+  // from the top-left corner, so that contiguous ranges are sectors
+  const unsigned ntarget = 4*unsigned(nx+ny);
+  std::vector<float> horizon_tan(fNAzimuth, -1e30f);
+
+#pragma omp parallel
+  {
+    std::vector<float> sector_tan(fNAzimuth, -1e30f);
+
+    unsigned t0;
+    unsigned t1;
+    dtedThreadBand(ntarget, t0, t1);
+    for(unsigned it=t0;it<t1;it++)
+      {
+	int32_t tx;
+	int32_t ty;
+	if(it < unsigned(2*nx))
+	  tx = -nx+int32_t(it), ty = ny;
+	else if(it < unsigned(2*nx+2*ny))
+	  tx = nx, ty = ny-int32_t(it-2*nx);
+	else if(it < unsigned(4*nx+2*ny))
+	  tx = nx-int32_t(it-2*nx-2*ny), ty = -ny;
+	else
+	  tx = -nx, ty = -ny+int32_t(it-4*nx-2*ny);
+
+	// Walk the ray one cell at a time along its major axis,
+	// interpolating across the minor axis
+	const int32_t nstep = std::max(abs(tx),abs(ty));
+	const bool major_x = abs(tx) >= abs(ty);
+	double max_tan = -1e30;
+	for(int32_t is=1;is<=nstep;is++)
+	  {
+	    const double f = double(is)/double(nstep);
+	    const double fx = double(tx)*f;
+	    const double fy = double(ty)*f;
+	    const double d =
+	      sqrt(fx*fx*scale_x*scale_x + fy*fy*scale_y*scale_y);
+	    if(d > fMaxDistance)break;
+
+	    const double minor = major_x ? fy : fx;
+	    const int32_t m0 = int32_t(floor(minor));
+	    const double w1 = minor-double(m0);
+	    int32_t x0;
+	    int32_t y0;
+	    int32_t x1;
+	    int32_t y1;
+	    if(major_x)
+	      x0 = x1 = int32_t(x)+int32_t(floor(fx+0.5)),
+		y0 = int32_t(y)+m0, y1 = y0+1;
+	    else
+	      y0 = y1 = int32_t(y)+int32_t(floor(fy+0.5)),
+		x0 = int32_t(x)+m0, x1 = x0+1;
+	    if((x0<0)||(y0<0)||(x1>=int32_t(map.width()))||
+	       (y1>=int32_t(map.height())))
+	      break;
+
+	    const int32_t z0 = map.datum(x0,y0);
+	    const int32_t z1 = map.datum(x1,y1);
+	    if((z0==VOID)||(z1==VOID))continue;
+	    const double z = double(z0)*(1.0-w1)+double(z1)*w1;
+	    const double tan_el = (z - d*d*curvature - z_obs)/d;
+
+	    if(visible && (tan_el >= max_tan))
+	      {
+		const int32_t vx = (major_x||w1<0.5) ? x0 : x1;
+		const int32_t vy = (!major_x||w1<0.5) ? y0 : y1;
+#pragma omp atomic write
+		(*visible)[vy*map.width()+vx] = 1;
+	      }
+	    if(tan_el > max_tan)max_tan = tan_el;
+	  }
+
+	double az = atan2(double(tx)*scale_x, double(ty)*scale_y);
+	if(az < 0)az += 2.0*M_PI;
+	unsigned ibin = unsigned(az/(2.0*M_PI)*fNAzimuth);
+	if(ibin >= fNAzimuth)ibin = 0;
+	sector_tan[ibin] = std::max(sector_tan[ibin], float(max_tan));
+      }
+
+#pragma omp critical
+    for(unsigned i=0;i<fNAzimuth;i++)
+      horizon_tan[i] = std::max(horizon_tan[i], sector_tan[i]);
+  }
+
+  // Bins narrower than the ray spacing may have no ray of their own; take
+  // the nearest populated bin going round in either direction
+  std::vector<float> filled(horizon_tan);
+  for(unsigned i=0;i<fNAzimuth;i++)
+    for(unsigned j=1;(filled[i]<=-1e30f)&&(j<fNAzimuth);j++)
+      filled[i] = std::max(horizon_tan[(i+j)%fNAzimuth],
+			   horizon_tan[(i+fNAzimuth-j)%fNAzimuth]);
+
+  for(unsigned i=0;i<fNAzimuth;i++)
+    if(filled[i] > -1e30f)
+      profile.fElevation[i] = float(atan(filled[i])/M_PI*180.0);
+  profile.fObstruction = DTEDHorizonProfile::obstruction(profile.fElevation);
+}
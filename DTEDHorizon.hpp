@@ -0,0 +1,76 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file DTEDHorizon.hpp
+
+  Horizon profile, sky obstruction and viewshed around an observer
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#ifndef DTEDHORIZON_HPP
+#define DTEDHORIZON_HPP
+
+#include <vector>
+#include <stdint.h>
+
+#include "DTED.hpp"
+
+//! VERITAS namespace
+namespace VERITAS
+{
+
+  class DTEDHorizonProfile
+  {
+  public:
+    DTEDHorizonProfile(): fGroundElevation(), fElevation(), fObstruction() { }
+
+    //! Fraction of the solid angle of the sky above the astronomical
+    //! horizon that is hidden by terrain
+    static double obstruction(const std::vector<float>& elevation);
+
+    double             fGroundElevation;  //!< m, -32768 if void
+    std::vector<float> fElevation;        //!< deg, azimuth bins from N to E
+    double             fObstruction;
+  };
+
+  //! Horizon and viewshed calculation using the R2 sweep: one ray from
+  //! the observer to each cell on the boundary of the search square, with
+  //! every cell crossed updated along the way, so the cost is proportional
+  //! to the number of cells rather than cells times distance. Rays are
+  //! split into azimuth sectors across threads. Heights include the drop
+  //! due to earth curvature with refraction coefficient k.
+  class DTEDHorizon
+  {
+  public:
+    DTEDHorizon(double max_distance, unsigned nazimuth = 360,
+		double earth_radius = 6367444.0, double refraction = 0.13):
+      fMaxDistance(max_distance), fNAzimuth(nazimuth),
+      fEarthRadius(earth_radius), fRefraction(refraction) { }
+
+    //! Pixels the map must extend beyond the observer at given latitude
+    void margin(double latitude_deg, uint32_t resolution,
+		unsigned& mx, unsigned& my) const;
+
+    //! Profile for observer at map pixel (x,y), height above ground. If
+    //! visible is given it is resized to the map and cells that can be
+    //! seen from the observer set to 1.
+    void compute(const DTEDView& map, unsigned x, unsigned y,
+		 double observer_height, DTEDHorizonProfile& profile,
+		 std::vector<uint8_t>* visible = 0) const;
+
+  private:
+    double   fMaxDistance;  //!< m
+    unsigned fNAzimuth;
+    double   fEarthRadius;  //!< m
+    double   fRefraction;
+  };
+
+}
+
+#endif // DTEDHORIZON_HPP
@@ -0,0 +1,106 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file DTEDParallel.cpp
+
+  Helpers for splitting DTED kernels into row bands across OpenMP threads
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+#include <sched.h>
+#include <pthread.h>
+
+#include "DTEDParallel.hpp"
+
+using namespace VERITAS;
+
+namespace
+{
+  // Parse a sysfs CPU list such as "0-15,32-47"
+  std::vector<int> parseCPUList(const std::string& list)
+  {
+    std::vector<int> cpus;
+    std::istringstream stream(list);
+    std::string range;
+    while(std::getline(stream, range, ','))
+      {
+	int first = 0;
+	int last = 0;
+	char dash = 0;
+	std::istringstream range_stream(range);
+	if(!(range_stream >> first))continue;
+	if(!(range_stream >> dash >> last) || (dash != '-'))last = first;
+	for(int cpu=first;cpu<=last;cpu++)cpus.push_back(cpu);
+      }
+    return cpus;
+  }
+}
+
+bool VERITAS::dtedPinThreads(std::ostream* log)
+{
+#ifdef _OPENMP
+  if(getenv("OMP_PROC_BIND") || getenv("GOMP_CPU_AFFINITY"))return false;
+
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0)return false;
+
+  // CPUs we may run on, node by node, then any that sysfs did not list
+  std::vector<int> order;
+  std::vector<bool> taken(CPU_SETSIZE, false);
+  for(unsigned node=0;;node++)
+    {
+      std::ostringstream name;
+      name << "/sys/devices/system/node/node" << node << "/cpulist";
+      std::ifstream stream(name.str().c_str());
+      std::string list;
+      if(!stream || !std::getline(stream, list))break;
+      std::vector<int> cpus = parseCPUList(list);
+      for(unsigned i=0;i<cpus.size();i++)
+	if((cpus[i]>=0)&&(cpus[i]<CPU_SETSIZE)&&
+	   CPU_ISSET(cpus[i], &allowed)&&!taken[cpus[i]])
+	  order.push_back(cpus[i]), taken[cpus[i]] = true;
+    }
+  for(int cpu=0;cpu<CPU_SETSIZE;cpu++)
+    if(CPU_ISSET(cpu, &allowed)&&!taken[cpu])order.push_back(cpu);
+  if(order.empty())return false;
+
+  // GNU OpenMP keeps the same threads for later teams of the same size,
+  // so their affinity carries over to every parallel region after this
+  const unsigned ncpu = order.size();
+  bool ok = true;
+#pragma omp parallel
+  {
+    const unsigned nthread = dtedThreadCount();
+    const unsigned ithread = dtedThreadNum();
+    const int cpu = order[(unsigned long long)(ithread)*ncpu/nthread];
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    const bool pinned =
+      (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0);
+#pragma omp critical
+    {
+      if(!pinned)ok = false;
+      if(log)*log << "Thread " << ithread << " -> CPU " << cpu
+		  << (pinned ? "" : " (failed)") << std::endl;
+    }
+  }
+  return ok;
+#else
+  if(log)*log << "Built without OpenMP, threads not pinned" << std::endl;
+  return false;
+#endif
+}
@@ -0,0 +1,71 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file DTEDParallel.hpp
+
+  Helpers for splitting DTED kernels into row bands across OpenMP threads
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#ifndef DTEDPARALLEL_HPP
+#define DTEDPARALLEL_HPP
+
+#include <iosfwd>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace VERITAS
+{
+
+  //! Number of threads in the current parallel region (1 if none)
+  inline unsigned dtedThreadCount()
+  {
+#ifdef _OPENMP
+    return unsigned(omp_get_num_threads());
+#else
+    return 1;
+#endif
+  }
+
+  //! Index of the calling thread in the current parallel region
+  inline unsigned dtedThreadNum()
+  {
+#ifdef _OPENMP
+    return unsigned(omp_get_thread_num());
+#else
+    return 0;
+#endif
+  }
+
+  //! Contiguous band [begin,end) of n rows for band i of nband
+  inline void dtedBand(unsigned n, unsigned i, unsigned nband,
+		       unsigned& begin, unsigned& end)
+  {
+    begin = unsigned((unsigned long long)(n)*i/nband);
+    end   = unsigned((unsigned long long)(n)*(i+1)/nband);
+  }
+
+  //! Band of n rows belonging to the calling thread
+  inline void dtedThreadBand(unsigned n, unsigned& begin, unsigned& end)
+  {
+    dtedBand(n, dtedThreadNum(), dtedThreadCount(), begin, end);
+  }
+
+  //! Pin each thread of the OpenMP team to one CPU, with CPUs ordered by
+  //! NUMA node so that consecutive threads, and so consecutive row
+  //! bands, share a node and the team is spread evenly over the nodes.
+  //! Does nothing if OMP_PROC_BIND or GOMP_CPU_AFFINITY is set, leaving
+  //! placement to the runtime. Returns true if the threads were pinned.
+  bool dtedPinThreads(std::ostream* log = 0);
+
+}
+
+#endif // DTEDPARALLEL_HPP
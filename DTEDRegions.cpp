@@ -0,0 +1,296 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file DTEDRegions.cpp
+
+  Connected-component labelling of selected pixels into regions, stitched
+  across tile boundaries
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+
+#include "DTEDRegions.hpp"
+#include "DTEDParallel.hpp"
+
+using namespace VERITAS;
+
+namespace
+{
+  const uint32_t NONE = 0xFFFFFFFFU;
+
+  // Union-find on pixel labels with the root being the lowest index.
+  // In the parallel phase only called on labels from one band.
+  uint32_t root(std::vector<uint32_t>& label, uint32_t i)
+  {
+    while(label[i] != i)
+      {
+	label[i] = label[label[i]];
+	i = label[i];
+      }
+    return i;
+  }
+
+  void join(std::vector<uint32_t>& label, uint32_t a, uint32_t b)
+  {
+    a = root(label, a);
+    b = root(label, b);
+    if(a<b)label[b] = a;
+    else if(b<a)label[a] = b;
+  }
+
+  int64_t cross(const DTEDRegion::Point& o, const DTEDRegion::Point& a,
+		const DTEDRegion::Point& b)
+  {
+    return int64_t(a.first-o.first)*int64_t(b.second-o.second)
+      - int64_t(a.second-o.second)*int64_t(b.first-o.first);
+  }
+}
+
+// ----------------------------------------------------------------------------
+// DTED Region
+// ----------------------------------------------------------------------------
+
+void DTEDRegion::merge(const DTEDRegion& o)
+{
+  if(o.fPixels == 0)return;
+  if(fPixels == 0) { *this = o; return; }
+  fPixels += o.fPixels;
+  fArea   += o.fArea;
+  fSumX   += o.fSumX;
+  fSumY   += o.fSumY;
+  fXMin    = std::min(fXMin, o.fXMin);
+  fXMax    = std::max(fXMax, o.fXMax);
+  fYMin    = std::min(fYMin, o.fYMin);
+  fYMax    = std::max(fYMax, o.fYMax);
+  fElMin   = std::min(fElMin, o.fElMin);
+  fElMax   = std::max(fElMax, o.fElMax);
+  fElSum  += o.fElSum;
+  fOutline.insert(fOutline.end(), o.fOutline.begin(), o.fOutline.end());
+}
+
+// ----------------------------------------------------------------------------
+// DTED Region Labeller
+// ----------------------------------------------------------------------------
+
+void DTEDRegionLabeller::convexHull(std::vector<DTEDRegion::Point>& points)
+{
+  // Andrew's monotone chain
+  std::sort(points.begin(), points.end());
+  points.erase(std::unique(points.begin(), points.end()), points.end());
+  if(points.size()<3)return;
+
+  std::vector<DTEDRegion::Point> hull(2*points.size());
+  unsigned k = 0;
+  for(unsigned i=0;i<points.size();i++)
+    {
+      while((k>=2)&&(cross(hull[k-2],hull[k-1],points[i])<=0))k--;
+      hull[k++] = points[i];
+    }
+  for(unsigned i=points.size()-1, t=k+1;i>0;i--)
+    {
+      while((k>=t)&&(cross(hull[k-2],hull[k-1],points[i-1])<=0))k--;
+      hull[k++] = points[i-1];
+    }
+  hull.resize(k-1);
+  points.swap(hull);
+}
+
+uint32_t DTEDRegionLabeller::find(uint32_t i) const
+{
+  while(fParent[i] != i)
+    {
+      fParent[i] = fParent[fParent[i]];
+      i = fParent[i];
+    }
+  return i;
+}
+
+void DTEDRegionLabeller::unite(uint32_t a, uint32_t b)
+{
+  a = find(a);
+  b = find(b);
+  if(a<b)fParent[b] = a;
+  else if(b<a)fParent[a] = b;
+}
+
+void DTEDRegionLabeller::add(const DTEDTerrainStats& stats,
+			     const std::vector<uint8_t>& select)
+{
+  const unsigned w = stats.width();
+  const unsigned h = stats.height();
+  assert(select.size() == w*h);
+  assert((stats.flags() & DTEDTerrainStats::S_RANGE) &&
+	 (stats.flags() & DTEDTerrainStats::S_MEAN));
+  if(w*h == 0)return;
+
+  // --------------------------------------------------------------------------
+  // Label each row band independently, then join across band boundaries
+  // --------------------------------------------------------------------------
+
+  std::vector<uint32_t> label(w*h, NONE);
+  unsigned nband = 1;
+
+#pragma omp parallel
+  {
+#pragma omp single
+    nband = dtedThreadCount();
+
+    unsigned y0;
+    unsigned y1;
+    dtedThreadBand(h, y0, y1);
+    for(unsigned y=y0;y<y1;y++)
+      for(unsigned x=0;x<w;x++)
+	{
+	  const uint32_t k = y*w+x;
+	  if(!select[k])continue;
+	  label[k] = k;
+	  if((x>0)&&select[k-1])join(label, k, k-1);
+	  if((y>y0)&&select[k-w])join(label, k, k-w);
+	}
+  }
+
+  for(unsigned i=1;i<nband;i++)
+    {
+      unsigned y0;
+      unsigned y1;
+      dtedBand(h, i, nband, y0, y1);
+      if((y0==0)||(y0>=y1))continue;
+      for(unsigned x=0;x<w;x++)
+	{
+	  const uint32_t k = y0*w+x;
+	  if(select[k]&&select[k-w])join(label, k, k-w);
+	}
+    }
+
+  // --------------------------------------------------------------------------
+  // Accumulate one region per root
+  // --------------------------------------------------------------------------
+
+  // Parents always have lower indices than their children, so a single
+  // pass in index order leaves every label pointing at its root
+  for(uint32_t k=0;k<w*h;k++)
+    if(select[k])label[k] = label[label[k]];
+
+  std::vector<uint32_t> region_of(w*h, NONE);
+
+  const uint32_t first_region = fRegions.size();
+  const int32_t res = int32_t(stats.resolution());
+  const double pixel_scale = fEarthRadius*M_PI/180.0/double(res);
+  std::vector<std::vector<DTEDRegion::Point> > outline;
+
+  for(unsigned y=0;y<h;y++)
+    {
+      const int32_t gy = stats.bottom()+int32_t(y);
+      const double pixel_area =
+	pixel_scale*pixel_scale*cos(double(gy)/double(res)/180.0*M_PI);
+      for(unsigned x=0;x<w;x++)
+	{
+	  const uint32_t k = y*w+x;
+	  if(!select[k])continue;
+
+	  // Roots are the lowest index in their set, so always seen first
+	  if(label[k] == k)
+	    {
+	      region_of[k] = fRegions.size();
+	      fRegions.push_back(DTEDRegion());
+	      fParent.push_back(fParent.size());
+	      if(fOutline)outline.resize(outline.size()+1);
+	    }
+	  const uint32_t ir = region_of[label[k]];
+
+	  const int32_t gx = stats.left()+int32_t(x);
+	  DTEDRegion& region = fRegions[ir];
+	  if(region.fPixels == 0)
+	    {
+	      region.fXMin = region.fXMax = gx;
+	      region.fYMin = region.fYMax = gy;
+	    }
+	  region.fPixels++;
+	  region.fArea  += pixel_area;
+	  region.fSumX  += gx;
+	  region.fSumY  += gy;
+	  region.fXMin   = std::min(region.fXMin, gx);
+	  region.fXMax   = std::max(region.fXMax, gx);
+	  region.fYMin   = std::min(region.fYMin, gy);
+	  region.fYMax   = std::max(region.fYMax, gy);
+	  region.fElMin  = std::min(region.fElMin, stats.fMin[k]);
+	  region.fElMax  = std::max(region.fElMax, stats.fMax[k]);
+	  region.fElSum += stats.fMean[k];
+
+	  // The ends of each run of pixels along a row are enough to
+	  // define the convex hull
+	  if(fOutline &&
+	     ((x==0)||!select[k-1]||(x==w-1)||!select[k+1]))
+	    outline[ir-first_region].push_back(DTEDRegion::Point(gx,gy));
+	}
+    }
+
+  if(fOutline)
+    for(unsigned i=0;i<outline.size();i++)
+      {
+	convexHull(outline[i]);
+	fRegions[first_region+i].fOutline.swap(outline[i]);
+      }
+
+  // --------------------------------------------------------------------------
+  // Join with regions of earlier tiles that touch along the tile edges
+  // --------------------------------------------------------------------------
+
+  for(unsigned y=0;y<h;y++)
+    for(unsigned x=0;x<w;x++)
+      {
+	// Interior of all but the first and last rows: skip to last column
+	if((x==1)&&(y!=0)&&(y!=h-1)&&(w>2))x=w-1;
+	const uint32_t k = y*w+x;
+	if(!select[k])continue;
+
+	const uint32_t ir = region_of[label[k]];
+	const int32_t gx = stats.left()+int32_t(x);
+	const int32_t gy = stats.bottom()+int32_t(y);
+	const Key neighbour[4] = {
+	  Key(DTEDMap::round(gx-1,res),gy), Key(DTEDMap::round(gx+1,res),gy),
+	  Key(DTEDMap::round(gx,res),gy-1), Key(DTEDMap::round(gx,res),gy+1) };
+	const bool outside[4] = { x==0, x==w-1, y==0, y==h-1 };
+	for(unsigned i=0;i<4;i++)
+	  if(outside[i])
+	    {
+	      std::map<Key,uint32_t>::const_iterator j =
+		fEdge.find(neighbour[i]);
+	      if(j != fEdge.end())unite(ir, j->second);
+	    }
+	// A pixel already on the edge of an earlier tile means the tiles
+	// overlap, and the pixel would be counted twice
+	const Key own(DTEDMap::round(gx,res),gy);
+	assert(fEdge.find(own) == fEdge.end());
+	fEdge[own] = ir;
+      }
+}
+
+void DTEDRegionLabeller::regions(std::vector<DTEDRegion>& regions) const
+{
+  regions.clear();
+  std::vector<uint32_t> index(fRegions.size(), NONE);
+  for(uint32_t i=0;i<fRegions.size();i++)
+    {
+      uint32_t r = find(i);
+      if(index[r] == NONE)
+	{
+	  index[r] = regions.size();
+	  regions.push_back(DTEDRegion());
+	}
+      regions[index[r]].merge(fRegions[i]);
+    }
+
+  if(fOutline)
+    for(unsigned i=0;i<regions.size();i++)
+      convexHull(regions[i].fOutline);
+}
@@ -0,0 +1,99 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file DTEDRegions.hpp
+
+  Connected-component labelling of selected pixels into regions, stitched
+  across tile boundaries
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#ifndef DTEDREGIONS_HPP
+#define DTEDREGIONS_HPP
+
+#include <vector>
+#include <map>
+#include <utility>
+#include <stdint.h>
+
+#include "DTEDStats.hpp"
+
+//! VERITAS namespace
+namespace VERITAS
+{
+
+  //! Summary of one 4-connected region. Coordinates are in map pixel
+  //! units (1/resolution of a degree), as in find_flat's pixel output.
+  class DTEDRegion
+  {
+  public:
+    DTEDRegion():
+      fPixels(), fArea(), fSumX(), fSumY(), fXMin(), fXMax(), fYMin(), fYMax(),
+      fElMin(32767), fElMax(-32768), fElSum(), fOutline() { }
+
+    double centroidX() const { return fPixels ? fSumX/double(fPixels) : 0; }
+    double centroidY() const { return fPixels ? fSumY/double(fPixels) : 0; }
+    double meanElevation() const
+    { return fPixels ? fElSum/double(fPixels) : 0; }
+
+    void merge(const DTEDRegion& o);
+
+    typedef std::pair<int32_t,int32_t> Point;
+
+    uint64_t           fPixels;
+    double             fArea;      //!< m^2
+    double             fSumX;
+    double             fSumY;
+    int32_t            fXMin;
+    int32_t            fXMax;
+    int32_t            fYMin;
+    int32_t            fYMax;
+    int16_t            fElMin;     //!< min of footprint minima
+    int16_t            fElMax;     //!< max of footprint maxima
+    double             fElSum;     //!< sum of footprint means
+    std::vector<Point> fOutline;   //!< convex hull, anticlockwise
+  };
+
+  //! Labels the selected pixels of successive tiles of terrain statistics
+  //! and merges regions that touch across tile edges. Tiles must abut
+  //! without overlapping, so of the samples SRTM tiles share along their
+  //! edges each must be selected in one tile only, as find_flat does.
+  class DTEDRegionLabeller
+  {
+  public:
+    DTEDRegionLabeller(double earth_radius, bool outline = false):
+      fEarthRadius(earth_radius), fOutline(outline), fRegions(), fParent(),
+      fEdge() { }
+
+    //! Label pixels of stats for which select is non-zero. The stats
+    //! must include S_RANGE and S_MEAN.
+    void add(const DTEDTerrainStats& stats,
+	     const std::vector<uint8_t>& select);
+
+    //! Regions found so far with all cross-tile merges applied
+    void regions(std::vector<DTEDRegion>& regions) const;
+
+    static void convexHull(std::vector<DTEDRegion::Point>& points);
+
+  private:
+    typedef std::pair<int32_t,int32_t> Key;
+
+    uint32_t find(uint32_t i) const;
+    void unite(uint32_t a, uint32_t b);
+
+    double                       fEarthRadius; //!< m
+    bool                         fOutline;
+    std::vector<DTEDRegion>      fRegions;
+    mutable std::vector<uint32_t> fParent;
+    std::map<Key,uint32_t>       fEdge;        //!< tile-edge pixel labels
+  };
+
+}
+
+#endif // DTEDREGIONS_HPP
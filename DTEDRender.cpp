@@ -0,0 +1,407 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file DTEDRender.cpp
+
+  Hillshaded colour-relief images of maps, written as PNG
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#include <iostream>
+#include <cmath>
+#include <cstdio>
+#include <cassert>
+#include <algorithm>
+
+#include <zlib.h>
+
+#include "DTEDRender.hpp"
+#include "DTEDParallel.hpp"
+
+using namespace VERITAS;
+
+namespace
+{
+  const int16_t VOID = -32768;
+
+  // Copy a row of samples into floats with one sample of padding at
+  // either end repeating the edge, and a matching 1/0 validity row
+  template<typename T> void loadRow(const T* src, unsigned w,
+				    float* __restrict z, float* __restrict v)
+  {
+    for(unsigned i=0;i<w;i++)
+      {
+	const bool valid = (src[i] != T(VOID));
+	z[i+1] = valid ? float(src[i]) : 0.0f;
+	v[i+1] = valid ? 1.0f : 0.0f;
+      }
+    z[0] = z[1];
+    v[0] = v[1];
+    z[w+1] = z[w];
+    v[w+1] = v[w];
+  }
+
+  // Load row r of h into slot r modulo three of the ring of padded rows,
+  // repeating the edge rows for those off the top and bottom
+  template<typename T> void loadRingRow(const T* z, unsigned w, unsigned h,
+					size_t stride, int32_t r,
+					float* zring, float* vring)
+  {
+    const unsigned src = unsigned(std::min(std::max(r,0),int32_t(h)-1));
+    const unsigned slot = unsigned(r+3)%3;
+    loadRow(z+size_t(src)*stride, w, zring+slot*(w+2), vring+slot*(w+2));
+  }
+
+  void putUInt32(std::vector<uint8_t>& buffer, uint32_t x)
+  {
+    buffer.push_back(uint8_t(x>>24));
+    buffer.push_back(uint8_t(x>>16));
+    buffer.push_back(uint8_t(x>>8));
+    buffer.push_back(uint8_t(x));
+  }
+
+  bool writeChunk(FILE* fp, const char* type,
+		  const uint8_t* data, size_t n)
+  {
+    std::vector<uint8_t> head;
+    putUInt32(head, uint32_t(n));
+    head.insert(head.end(), type, type+4);
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, &head[4], 4);
+    if(n)crc = crc32(crc, data, uInt(n));
+    std::vector<uint8_t> tail;
+    putUInt32(tail, uint32_t(crc));
+    return (fwrite(&head.front(), 1, head.size(), fp) == head.size()) &&
+      ((n == 0) || (fwrite(data, 1, n, fp) == n)) &&
+      (fwrite(&tail.front(), 1, tail.size(), fp) == tail.size());
+  }
+}
+
+// ----------------------------------------------------------------------------
+// DTED Colour Ramp
+// ----------------------------------------------------------------------------
+
+DTEDColourRamp::DTEDColourRamp(): fElevation(), fRGB()
+{
+  add(   0,   0,  60,   0);
+  add(1000,   0, 120,   0);
+  add(1500,  60, 160,   0);
+  add(2500, 180, 180,  60);
+  add(5000, 180, 180, 180);
+  add(8000, 255, 255, 255);
+}
+
+void DTEDColourRamp::clear()
+{
+  fElevation.clear();
+  fRGB.clear();
+}
+
+void DTEDColourRamp::add(double elevation, uint8_t r, uint8_t g, uint8_t b)
+{
+  assert(fElevation.empty() || (elevation > fElevation.back()));
+  fElevation.push_back(elevation);
+  fRGB.push_back(r);
+  fRGB.push_back(g);
+  fRGB.push_back(b);
+}
+
+void DTEDColourRamp::colour(double z, float* rgb) const
+{
+  const unsigned n = fElevation.size();
+  if(n == 0)
+    {
+      rgb[0] = rgb[1] = rgb[2] = 0;
+      return;
+    }
+
+  unsigned i =
+    std::upper_bound(fElevation.begin(), fElevation.end(), z) -
+    fElevation.begin();
+  if(i == 0)
+    {
+      std::copy(&fRGB[0], &fRGB[0]+3, rgb);
+      return;
+    }
+  if(i == n)
+    {
+      std::copy(&fRGB[3*(n-1)], &fRGB[3*(n-1)]+3, rgb);
+      return;
+    }
+
+  const double t = (z-fElevation[i-1])/(fElevation[i]-fElevation[i-1]);
+  for(unsigned k=0;k<3;k++)
+    rgb[k] = float((1.0-t)*fRGB[3*(i-1)+k] + t*fRGB[3*i+k]);
+}
+
+void DTEDColourRamp::table(float& z0, std::vector<float>& rgb) const
+{
+  if(fElevation.empty())
+    {
+      z0 = 0;
+      rgb.assign(3, 0.0f);
+      return;
+    }
+
+  z0 = float(fElevation.front());
+  const unsigned n =
+    unsigned(ceil(fElevation.back()-fElevation.front()))+1;
+  rgb.resize(3*n);
+  for(unsigned i=0;i<n;i++)colour(double(z0)+double(i), &rgb[3*i]);
+}
+
+// ----------------------------------------------------------------------------
+// DTED Renderer
+// ----------------------------------------------------------------------------
+
+template<typename T>
+void DTEDRenderer::renderRows(const T* z, unsigned w, unsigned h,
+			      size_t stride,
+			      const double* scale_x, double scale_y,
+			      std::vector<uint8_t>& rgba) const
+{
+  rgba.assign(size_t(w)*size_t(h)*4, 0);
+  if((w == 0)||(h == 0))return;
+
+  float z0;
+  std::vector<float> table;
+  fRamp.table(z0, table);
+  const int32_t ntable = int32_t(table.size()/3);
+
+  const double az  = fAzimuth/180.0*M_PI;
+  const double alt = fAltitude/180.0*M_PI;
+  const float lx  = float(sin(az)*cos(alt));
+  const float ly  = float(cos(az)*cos(alt));
+  const float lz  = float(sin(alt));
+  const float amb = float(fAmbient);
+
+#pragma omp parallel
+  {
+    const unsigned pw = w+2;
+    std::vector<float> zring(3*pw);
+    std::vector<float> vring(3*pw);
+    std::vector<float> shade(w);
+
+    unsigned band_begin;
+    unsigned band_end;
+    dtedThreadBand(h, band_begin, band_end);
+
+    for(unsigned y=band_begin;y<band_end;y++)
+      {
+	const int32_t r = int32_t(y);
+	if(y == band_begin)
+	  {
+	    loadRingRow(z, w, h, stride, r-1, &zring.front(), &vring.front());
+	    loadRingRow(z, w, h, stride, r, &zring.front(), &vring.front());
+	  }
+	loadRingRow(z, w, h, stride, r+1, &zring.front(), &vring.front());
+
+	const float* __restrict zn = &zring[(unsigned(r+4)%3)*pw];
+	const float* __restrict zc = &zring[(unsigned(r+3)%3)*pw];
+	const float* __restrict zs = &zring[(unsigned(r+2)%3)*pw];
+	const float* __restrict vn = &vring[(unsigned(r+4)%3)*pw];
+	const float* __restrict vc = &vring[(unsigned(r+3)%3)*pw];
+	const float* __restrict vs = &vring[(unsigned(r+2)%3)*pw];
+	const float cx = float(fExaggeration/(8.0*scale_x[y]));
+	const float cy = float(fExaggeration/(8.0*scale_y));
+
+	float* __restrict s = &shade.front();
+	for(unsigned i=0;i<w;i++)
+	  {
+	    const float m = vn[i]*vn[i+1]*vn[i+2]*vc[i]*vc[i+1]*vc[i+2]*
+	      vs[i]*vs[i+1]*vs[i+2];
+	    const float gx =
+	      ((zn[i+2]+2.0f*zc[i+2]+zs[i+2])-(zn[i]+2.0f*zc[i]+zs[i]))*cx*m;
+	    const float gy =
+	      ((zn[i]+2.0f*zn[i+1]+zn[i+2])-(zs[i]+2.0f*zs[i+1]+zs[i+2]))*cy*m;
+	    const float l = (lz-gx*lx-gy*ly)/std::sqrt(1.0f+gx*gx+gy*gy);
+	    s[i] = amb + (1.0f-amb)*std::max(l, 0.0f);
+	  }
+
+	uint8_t* out = &rgba[size_t(h-1-y)*size_t(w)*4];
+	for(unsigned i=0;i<w;i++)
+	  {
+	    if(vc[i+1] == 0)continue;
+	    const int32_t k =
+	      std::min(std::max(int32_t(lrintf(zc[i+1]-z0)),0),ntable-1);
+	    const float* c = &table[3*k];
+	    out[4*i]   = uint8_t(c[0]*s[i]+0.5f);
+	    out[4*i+1] = uint8_t(c[1]*s[i]+0.5f);
+	    out[4*i+2] = uint8_t(c[2]*s[i]+0.5f);
+	    out[4*i+3] = 255;
+	  }
+      }
+  }
+}
+
+void DTEDRenderer::render(const DTEDView& map, std::vector<uint8_t>& rgba,
+			  double earth_radius) const
+{
+  const double res = double(map.resolution());
+  const double scale_y = earth_radius*M_PI/180.0/res;
+  std::vector<double> scale_x(map.height());
+  for(unsigned y=0;y<map.height();y++)
+    scale_x[y] = scale_y*cos(double(map.yCoordOf(y))/res/180.0*M_PI);
+  renderRows(map.data(), map.width(), map.height(), map.stride(),
+	     scale_x.empty() ? 0 : &scale_x.front(), scale_y, rgba);
+}
+
+void DTEDRenderer::render(const float* z, unsigned w, unsigned h,
+			  double scale_x, double scale_y,
+			  std::vector<uint8_t>& rgba) const
+{
+  std::vector<double> sx(h, scale_x);
+  renderRows(z, w, h, w, sx.empty() ? 0 : &sx.front(), scale_y, rgba);
+}
+
+void DTEDRenderer::mark(std::vector<uint8_t>& rgba, unsigned w, unsigned h,
+			const std::vector<DTEDMarker>& markers)
+{
+  for(unsigned im=0;im<markers.size();im++)
+    {
+      const DTEDMarker& m = markers[im];
+      const double reach = m.fRadius+0.5*m.fWidth;
+      const int32_t xa = std::max(int32_t(floor(m.fX-reach)), 0);
+      const int32_t xb = std::min(int32_t(ceil(m.fX+reach)), int32_t(w)-1);
+      const int32_t ya = std::max(int32_t(floor(m.fY-reach)), 0);
+      const int32_t yb = std::min(int32_t(ceil(m.fY+reach)), int32_t(h)-1);
+      for(int32_t y=ya;y<=yb;y++)
+	for(int32_t x=xa;x<=xb;x++)
+	  {
+	    const double d = sqrt((x-m.fX)*(x-m.fX)+(y-m.fY)*(y-m.fY));
+	    if(fabs(d-m.fRadius) > 0.5*m.fWidth)continue;
+	    uint8_t* p = &rgba[(size_t(h-1-unsigned(y))*w+unsigned(x))*4];
+	    p[0] = m.fR;
+	    p[1] = m.fG;
+	    p[2] = m.fB;
+	    p[3] = 255;
+	  }
+    }
+}
+
+bool DTEDRenderer::writePNG(const std::string& filename,
+			    unsigned w, unsigned h,
+			    const std::vector<uint8_t>& rgba, int level)
+{
+  assert(rgba.size() == size_t(w)*size_t(h)*4);
+  const size_t line = size_t(w)*4;
+
+  // Each strip is filtered ("up", which suits smooth terrain) and
+  // deflated on its own, ending on a byte boundary with a sync flush so
+  // the pieces concatenate into one stream; their checksums are combined
+  std::vector<std::vector<uint8_t> > piece;
+  std::vector<uLong> piece_adler;
+  std::vector<size_t> piece_length;
+  bool ok = true;
+
+#pragma omp parallel
+  {
+#pragma omp single
+    {
+      piece.resize(dtedThreadCount());
+      piece_adler.resize(dtedThreadCount());
+      piece_length.resize(dtedThreadCount());
+    }
+
+    const unsigned ithread = dtedThreadNum();
+    const bool last = (ithread+1 == dtedThreadCount());
+    unsigned band_begin;
+    unsigned band_end;
+    dtedThreadBand(h, band_begin, band_end);
+
+    std::vector<uint8_t> raw((band_end-band_begin)*(line+1));
+    for(unsigned y=band_begin;y<band_end;y++)
+      {
+	const uint8_t* __restrict cur = &rgba[size_t(y)*line];
+	uint8_t* __restrict out = &raw[(y-band_begin)*(line+1)];
+	out[0] = 2;
+	if(y == 0)std::copy(cur, cur+line, out+1);
+	else
+	  {
+	    const uint8_t* __restrict prev = cur-line;
+	    for(size_t i=0;i<line;i++)out[i+1] = uint8_t(cur[i]-prev[i]);
+	  }
+      }
+
+    z_stream zs;
+    zs.zalloc = Z_NULL;
+    zs.zfree = Z_NULL;
+    zs.opaque = Z_NULL;
+    bool thread_ok = (deflateInit2(&zs, level, Z_DEFLATED, -15, 8,
+				   Z_DEFAULT_STRATEGY) == Z_OK);
+    if(thread_ok)
+      {
+	std::vector<uint8_t>& buffer = piece[ithread];
+	buffer.resize(deflateBound(&zs, raw.size())+64);
+	zs.next_in = raw.empty() ? Z_NULL : &raw.front();
+	zs.avail_in = uInt(raw.size());
+	zs.next_out = &buffer.front();
+	zs.avail_out = uInt(buffer.size());
+	const int status = deflate(&zs, last ? Z_FINISH : Z_SYNC_FLUSH);
+	thread_ok = last ? (status == Z_STREAM_END) :
+	  ((status == Z_OK) && (zs.avail_in == 0) && (zs.avail_out != 0));
+	buffer.resize(buffer.size()-zs.avail_out);
+	deflateEnd(&zs);
+      }
+
+    piece_adler[ithread] = adler32(adler32(0L, Z_NULL, 0),
+				   raw.empty() ? Z_NULL : &raw.front(),
+				   uInt(raw.size()));
+    piece_length[ithread] = raw.size();
+
+    if(!thread_ok)
+      {
+#pragma omp critical
+	ok = false;
+      }
+  }
+
+  if(!ok)
+    {
+      std::cerr << filename << ": could not compress image" << std::endl;
+      return false;
+    }
+
+  // zlib stream: header, deflate data, Adler-32 of the filtered rows
+  std::vector<uint8_t> idat;
+  idat.push_back(0x78);
+  idat.push_back(0x9C);
+  uLong adler = adler32(0L, Z_NULL, 0);
+  for(unsigned i=0;i<piece.size();i++)
+    {
+      idat.insert(idat.end(), piece[i].begin(), piece[i].end());
+      adler = adler32_combine(adler, piece_adler[i], piece_length[i]);
+    }
+  putUInt32(idat, uint32_t(adler));
+
+  std::vector<uint8_t> ihdr;
+  putUInt32(ihdr, w);
+  putUInt32(ihdr, h);
+  ihdr.push_back(8);  // bit depth
+  ihdr.push_back(6);  // RGBA
+  ihdr.push_back(0);  // deflate
+  ihdr.push_back(0);  // adaptive filtering
+  ihdr.push_back(0);  // no interlace
+
+  FILE* fp = fopen(filename.c_str(), "wb");
+  if(fp == 0)
+    {
+      std::cerr << filename << ": could not open for writing" << std::endl;
+      return false;
+    }
+
+  static const uint8_t SIGNATURE[8] = { 137,'P','N','G','\r','\n',26,'\n' };
+  ok = (fwrite(SIGNATURE, 1, sizeof(SIGNATURE), fp) == sizeof(SIGNATURE)) &&
+    writeChunk(fp, "IHDR", &ihdr.front(), ihdr.size()) &&
+    writeChunk(fp, "IDAT", &idat.front(), idat.size()) &&
+    writeChunk(fp, "IEND", 0, 0);
+  ok = (fclose(fp) == 0) && ok;
+  if(!ok)std::cerr << filename << ": could not write image" << std::endl;
+  return ok;
+}
@@ -0,0 +1,127 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file DTEDRender.hpp
+
+  Hillshaded colour-relief images of maps, written as PNG
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#ifndef DTEDRENDER_HPP
+#define DTEDRENDER_HPP
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "DTED.hpp"
+
+//! VERITAS namespace
+namespace VERITAS
+{
+
+  //! Colour ramp interpolated linearly between elevation breakpoints and
+  //! clamped beyond the first and last. The default is the ramp of
+  //! draw_map.m, from dark green at sea level to white at 8000m.
+  class DTEDColourRamp
+  {
+  public:
+    DTEDColourRamp();
+
+    void clear();
+    //! Add a breakpoint above all those already added
+    void add(double elevation, uint8_t r, uint8_t g, uint8_t b);
+
+    unsigned size() const { return fElevation.size(); }
+
+    //! Colour at elevation z as three values in [0,255]
+    void colour(double z, float* rgb) const;
+
+    //! Table of colours at 1m steps from the first breakpoint to the last
+    void table(float& z0, std::vector<float>& rgb) const;
+
+  private:
+    std::vector<double>  fElevation;
+    std::vector<float>   fRGB;
+  };
+
+  //! Circle drawn over the image, in pixels of the rendered raster with
+  //! y from the south, as the rows of the map
+  struct DTEDMarker
+  {
+    DTEDMarker(double x=0, double y=0, double radius=5, double width=2,
+	       uint8_t r=255, uint8_t g=0, uint8_t b=0):
+      fX(x), fY(y), fRadius(radius), fWidth(width), fR(r), fG(g), fB(b) { }
+    double  fX;
+    double  fY;
+    double  fRadius;
+    double  fWidth;
+    uint8_t fR;
+    uint8_t fG;
+    uint8_t fB;
+  };
+
+  //! Render elevations as RGBA pixels, the ramp colour scaled by Horn
+  //! hillshading under a distant light. Images are produced in strips of
+  //! rows, one per thread; each row is shaded by a branch-free loop over
+  //! padded float rows that the compiler vectorises, and the colours are
+  //! then looked up from a table. Void pixels are transparent and shade
+  //! their neighbours as if flat. Image rows run from the north.
+  class DTEDRenderer
+  {
+  public:
+    DTEDRenderer(const DTEDColourRamp& ramp = DTEDColourRamp()):
+      fRamp(ramp), fAzimuth(315), fAltitude(45), fExaggeration(1),
+      fAmbient(0.35) { }
+
+    //! Light direction [deg], azimuth clockwise from north
+    void setLight(double azimuth, double altitude)
+    { fAzimuth = azimuth; fAltitude = altitude; }
+    void setExaggeration(double exaggeration) { fExaggeration=exaggeration; }
+    //! Fraction of the colour left in full shadow
+    void setAmbient(double ambient) { fAmbient = ambient; }
+
+    const DTEDColourRamp& ramp() const { return fRamp; }
+
+    //! Render map, with the pixel scale of each row from its latitude
+    void render(const DTEDView& map, std::vector<uint8_t>& rgba,
+		double earth_radius = 6367444.1) const;
+
+    //! Render w by h elevations in rows from the south with given pixel
+    //! scale [m], -32768 where void, such as from DTEDResampler
+    void render(const float* z, unsigned w, unsigned h,
+		double scale_x, double scale_y,
+		std::vector<uint8_t>& rgba) const;
+
+    //! Draw markers onto an image rendered with height h
+    static void mark(std::vector<uint8_t>& rgba, unsigned w, unsigned h,
+		     const std::vector<DTEDMarker>& markers);
+
+    //! Write 8-bit RGBA PNG. Strips of rows are deflated in parallel and
+    //! joined into one stream.
+    static bool writePNG(const std::string& filename,
+			 unsigned w, unsigned h,
+			 const std::vector<uint8_t>& rgba, int level = 6);
+
+  private:
+    template<typename T> void renderRows(const T* z, unsigned w, unsigned h,
+					 size_t stride,
+					 const double* scale_x, double scale_y,
+					 std::vector<uint8_t>& rgba) const;
+
+    DTEDColourRamp fRamp;
+    double         fAzimuth;
+    double         fAltitude;
+    double         fExaggeration;
+    double         fAmbient;
+  };
+
+}
+
+#endif // DTEDRENDER_HPP
@@ -0,0 +1,333 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file DTEDResample.cpp
+
+  Separable resampling of maps onto a local east-north metric grid
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#include <cmath>
+#include <algorithm>
+
+#include "DTEDResample.hpp"
+#include "DTEDParallel.hpp"
+
+using namespace VERITAS;
+
+namespace
+{
+  // Largest spread of latitude, in map samples, over a run of grid
+  // points resampled with one set of vertical weights
+  const double RUN_TOLERANCE = 1.0/64.0;
+}
+
+// ----------------------------------------------------------------------------
+// DTED Local Grid
+// ----------------------------------------------------------------------------
+
+DTEDLocalGrid::DTEDLocalGrid(double longitude, double latitude,
+			     unsigned nx, unsigned ny, double spacing,
+			     double a, double b):
+  fLongitude(longitude), fLatitude(latitude), fNX(nx), fNY(ny),
+  fSpacing(spacing), fA(a), fE2(1.0-(b*b)/(a*a)),
+  fSinLat(sin(latitude/180.0*M_PI)), fCosLat(cos(latitude/180.0*M_PI)),
+  fX0(), fZ0(), fPointLatitude(nx*ny), fPointLongitude(nx*ny)
+{
+  const double n0 = fA/sqrt(1.0-fE2*fSinLat*fSinLat);
+  fX0 = n0*fCosLat;
+  fZ0 = n0*(1.0-fE2)*fSinLat;
+
+#pragma omp parallel for schedule(static)
+  for(int iy=0;iy<int(ny);iy++)
+    for(unsigned ix=0;ix<nx;ix++)
+      toGeodetic(easting(ix), northing(unsigned(iy)),
+		 fPointLongitude[iy*nx+ix], fPointLatitude[iy*nx+ix]);
+}
+
+// Geocentric coordinates are taken in a frame turned about the polar
+// axis so that the tangent point lies in the x-z plane; there east is
+// (0,1,0) and north is (-sin lat, 0, cos lat) at the tangent point.
+
+void DTEDLocalGrid::toGeodetic(double e, double n,
+			       double& longitude, double& latitude) const
+{
+  const double x = fX0 - fSinLat*n;
+  const double y = e;
+  const double z = fZ0 + fCosLat*n;
+  const double p = sqrt(x*x+y*y);
+
+  // The plane is within a few hundred m of the ellipsoid, where the
+  // fixed point iteration for latitude converges in a couple of steps
+  double phi = atan2(z, p*(1.0-fE2));
+  for(unsigned i=0;i<4;i++)
+    {
+      const double s = sin(phi);
+      const double nu = fA/sqrt(1.0-fE2*s*s);
+      const double h = p/cos(phi) - nu;
+      phi = atan2(z, p*(1.0-fE2*nu/(nu+h)));
+    }
+
+  latitude = phi/M_PI*180.0;
+  longitude = fLongitude + atan2(y, x)/M_PI*180.0;
+}
+
+void DTEDLocalGrid::toLocal(double longitude, double latitude,
+			    double& e, double& n) const
+{
+  const double phi = latitude/180.0*M_PI;
+  const double lambda = (longitude-fLongitude)/180.0*M_PI;
+  const double s = sin(phi);
+  const double nu = fA/sqrt(1.0-fE2*s*s);
+
+  // Point on the ellipsoid relative to the tangent point, and the
+  // ellipsoid normal there
+  const double dx = nu*cos(phi)*cos(lambda) - fX0;
+  const double dy = nu*cos(phi)*sin(lambda);
+  const double dz = nu*(1.0-fE2)*s - fZ0;
+  const double ux = cos(phi)*cos(lambda);
+  const double uy = cos(phi)*sin(lambda);
+  const double uz = s;
+
+  // Go along the normal to the tangent plane, whose normal is
+  // (cos lat, 0, sin lat)
+  const double h = -(dx*fCosLat + dz*fSinLat)/(ux*fCosLat + uz*fSinLat);
+  e = dy + h*uy;
+  n = -(dx + h*ux)*fSinLat + (dz + h*uz)*fCosLat;
+}
+
+double DTEDLocalGrid::meridianScale(double latitude_deg) const
+{
+  const double s = sin(latitude_deg/180.0*M_PI);
+  const double d = 1.0-fE2*s*s;
+  return fA*(1.0-fE2)/(d*sqrt(d))*M_PI/180.0;
+}
+
+double DTEDLocalGrid::parallelScale(double latitude_deg) const
+{
+  const double phi = latitude_deg/180.0*M_PI;
+  const double s = sin(phi);
+  return fA/sqrt(1.0-fE2*s*s)*cos(phi)*M_PI/180.0;
+}
+
+// ----------------------------------------------------------------------------
+// DTED Resampler
+// ----------------------------------------------------------------------------
+
+bool DTEDResampler::kernelByName(const std::string& name, Kernel& kernel)
+{
+  if(name == "box")kernel = K_BOX;
+  else if(name == "bilinear")kernel = K_BILINEAR;
+  else if(name == "lanczos")kernel = K_LANCZOS3;
+  else return false;
+  return true;
+}
+
+double DTEDResampler::radius() const
+{
+  switch(fKernel)
+    {
+    case K_BOX:      return 0.5;
+    case K_BILINEAR: return 1.0;
+    case K_LANCZOS3: return 3.0;
+    }
+  return 1.0;
+}
+
+double DTEDResampler::weight(double t) const
+{
+  t = fabs(t);
+  switch(fKernel)
+    {
+    case K_BOX:
+      return (t<0.5) ? 1.0 : ((t==0.5) ? 0.5 : 0.0);
+    case K_BILINEAR:
+      return (t<1.0) ? 1.0-t : 0.0;
+    case K_LANCZOS3:
+      if(t<1e-8)return 1.0;
+      if(t>=3.0)return 0.0;
+      return 3.0*sin(M_PI*t)*sin(M_PI*t/3.0)/(M_PI*M_PI*t*t);
+    }
+  return 0.0;
+}
+
+unsigned DTEDResampler::taps(double sigma) const
+{
+  return unsigned(ceil(2.0*radius()*sigma))+1;
+}
+
+void DTEDResampler::coefficients(double s, double sigma, unsigned ntap,
+				 int32_t& first, float* w) const
+{
+  // Weights for the samples around source position s, normalised over the
+  // whole kernel so that samples off the map count as missing
+  first = int32_t(ceil(s-radius()*sigma));
+  double sum = 0;
+  for(unsigned k=0;k<ntap;k++)
+    {
+      const double wk = weight((double(first+int32_t(k))-s)/sigma);
+      w[k] = float(wk);
+      sum += wk;
+    }
+  if(sum != 0)for(unsigned k=0;k<ntap;k++)w[k] = float(w[k]/sum);
+}
+
+void DTEDResampler::footprint(const DTEDLocalGrid& grid, uint32_t resolution,
+			      int32_t& left, int32_t& bottom,
+			      unsigned& w, unsigned& h) const
+{
+  const double res = double(resolution);
+  const unsigned ny = grid.ny();
+  const unsigned nx = grid.nx();
+
+  // Rows curve, so take the extent over every point
+  double lon_min = grid.longitude();
+  double lon_max = grid.longitude();
+  double lat_min = grid.latitude();
+  double lat_max = grid.latitude();
+  for(unsigned iy=0;iy<ny;iy++)
+    for(unsigned ix=0;ix<nx;ix++)
+      {
+	lon_min = std::min(lon_min, grid.pointLongitude(ix,iy));
+	lon_max = std::max(lon_max, grid.pointLongitude(ix,iy));
+	lat_min = std::min(lat_min, grid.pointLatitude(ix,iy));
+	lat_max = std::max(lat_max, grid.pointLatitude(ix,iy));
+      }
+
+  // Kernels are widest where degrees are shortest
+  double sigma_x = 1;
+  double sigma_y = 1;
+  const double lat[2] = { lat_min, lat_max };
+  for(unsigned i=0;i<2;i++)
+    {
+      sigma_x = std::max(sigma_x,
+			 grid.spacing()/grid.parallelScale(lat[i])*res);
+      sigma_y = std::max(sigma_y,
+			 grid.spacing()/grid.meridianScale(lat[i])*res);
+    }
+
+  const double mx = radius()*sigma_x+1;
+  const double my = radius()*sigma_y+1;
+  left   = int32_t(floor(lon_min*res-mx));
+  bottom = int32_t(floor(lat_min*res-my));
+  w      = unsigned(ceil(lon_max*res+mx)-double(left))+1;
+  h      = unsigned(ceil(lat_max*res+my)-double(bottom))+1;
+}
+
+void DTEDResampler::resample(const DTEDView& map, const DTEDLocalGrid& grid,
+			     std::vector<float>& out) const
+{
+  const int16_t VOID = -32768;
+  const double res = double(map.resolution());
+  const unsigned nx = grid.nx();
+  const unsigned ny = grid.ny();
+  const int32_t mw = int32_t(map.width());
+  const int32_t mh = int32_t(map.height());
+
+  out.assign(nx*ny, float(VOID));
+
+#pragma omp parallel
+  {
+    std::vector<float>   wy;
+    std::vector<int32_t> first_x(nx);
+    std::vector<float>   wx;
+    std::vector<float>   acc(map.width());
+    std::vector<float>   wacc(map.width());
+
+    unsigned y0;
+    unsigned y1;
+    dtedThreadBand(ny, y0, y1);
+    for(unsigned iy=y0;iy<y1;iy++)
+      for(unsigned ix0=0;ix0<nx;)
+	{
+	  // Run of points along the row whose latitudes agree closely
+	  // enough to share one set of vertical weights
+	  double lat_min = grid.pointLatitude(ix0,iy);
+	  double lat_max = lat_min;
+	  unsigned ix1 = ix0+1;
+	  for(;ix1<nx;ix1++)
+	    {
+	      const double l = grid.pointLatitude(ix1,iy);
+	      if((std::max(lat_max,l)-std::min(lat_min,l))*res >
+		 RUN_TOLERANCE)break;
+	      lat_min = std::min(lat_min,l);
+	      lat_max = std::max(lat_max,l);
+	    }
+	  const double lat = 0.5*(lat_min+lat_max);
+	  const unsigned npt = ix1-ix0;
+
+	  const double sigma_y =
+	    std::max(1.0, grid.spacing()/grid.meridianScale(lat)*res);
+	  const double sigma_x =
+	    std::max(1.0, grid.spacing()/grid.parallelScale(lat)*res);
+
+	  // Vertical weights for the run, and the table of horizontal
+	  // weights for each point along it
+	  const unsigned ntap_y = taps(sigma_y);
+	  wy.resize(ntap_y);
+	  int32_t first_y;
+	  coefficients(lat*res-double(map.bottom()), sigma_y, ntap_y,
+		       first_y, &wy.front());
+
+	  const unsigned ntap_x = taps(sigma_x);
+	  wx.resize(npt*ntap_x);
+	  int32_t c0 = mw;
+	  int32_t c1 = 0;
+	  for(unsigned i=0;i<npt;i++)
+	    {
+	      const double lon = grid.pointLongitude(ix0+i,iy)*res;
+	      const double ilon = floor(lon);
+	      const double s = double(map.xOf(int32_t(ilon))) + (lon-ilon);
+	      coefficients(s, sigma_x, ntap_x, first_x[i], &wx[i*ntap_x]);
+	      c0 = std::min(c0, first_x[i]);
+	      c1 = std::max(c1, first_x[i]+int32_t(ntap_x));
+	    }
+	  c0 = std::max(c0, 0);
+	  c1 = std::min(c1, mw);
+	  const unsigned ix = ix0;
+	  ix0 = ix1;
+	  if(c1 <= c0)continue;
+
+	  // Combine the source rows over the columns the run needs
+	  float* __restrict a = &acc.front();
+	  float* __restrict wa = &wacc.front();
+	  std::fill(a+c0, a+c1, 0.0f);
+	  std::fill(wa+c0, wa+c1, 0.0f);
+	  for(unsigned k=0;k<ntap_y;k++)
+	    {
+	      const int32_t y = first_y+int32_t(k);
+	      const float w = wy[k];
+	      if((y<0)||(y>=mh)||(w==0))continue;
+	      const int16_t* __restrict row = map.row(unsigned(y));
+	      for(int32_t c=c0;c<c1;c++)
+		{
+		  const float valid = (row[c]!=VOID) ? w : 0.0f;
+		  a[c] += valid*float(row[c]);
+		  wa[c] += valid;
+		}
+	    }
+
+	  // Apply the column weights
+	  float* o = &out[iy*nx+ix];
+	  for(unsigned i=0;i<npt;i++)
+	    {
+	      const float* w = &wx[i*ntap_x];
+	      const int32_t f = first_x[i];
+	      const unsigned k0 = unsigned(std::max(0, c0-f));
+	      const unsigned k1 =
+		unsigned(std::max(0, std::min(int32_t(ntap_x), c1-f)));
+	      float sum = 0;
+	      float wsum = 0;
+	      for(unsigned k=k0;k<k1;k++)
+		sum += w[k]*a[f+int32_t(k)], wsum += w[k]*wa[f+int32_t(k)];
+	      if(wsum >= 0.5f)o[i] = sum/wsum;
+	    }
+	}
+  }
+}
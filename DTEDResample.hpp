@@ -0,0 +1,132 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file DTEDResample.hpp
+
+  Separable resampling of maps onto a local east-north metric grid
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#ifndef DTEDRESAMPLE_HPP
+#define DTEDRESAMPLE_HPP
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "DTED.hpp"
+
+//! VERITAS namespace
+namespace VERITAS
+{
+
+  //! Square grid of nx by ny points with given spacing in metres on the
+  //! plane tangent to the WGS84 ellipsoid at a point, with axes east and
+  //! north there. Each grid point is taken to the ellipsoid along the
+  //! ellipsoid normal through it, so away from the central meridian the
+  //! rows curve away from the parallels: 1 m at 5 km, 113 m at 50 km east
+  //! of 30 degrees latitude. The geodetic position of every point is
+  //! kept.
+  class DTEDLocalGrid
+  {
+  public:
+    DTEDLocalGrid(double longitude, double latitude,
+		  unsigned nx, unsigned ny, double spacing,
+		  double a = 6378136.49, double b = 6356751.7);
+
+    unsigned nx() const { return fNX; }
+    unsigned ny() const { return fNY; }
+    double spacing() const { return fSpacing; }
+    double longitude() const { return fLongitude; }
+    double latitude() const { return fLatitude; }
+
+    double easting(unsigned ix) const
+    { return (double(ix)-0.5*double(fNX-1))*fSpacing; }
+    double northing(unsigned iy) const
+    { return (double(iy)-0.5*double(fNY-1))*fSpacing; }
+
+    //! Latitude of grid point [deg]
+    double pointLatitude(unsigned ix, unsigned iy) const
+    { return fPointLatitude[iy*fNX+ix]; }
+    //! Longitude of grid point [deg], not wrapped
+    double pointLongitude(unsigned ix, unsigned iy) const
+    { return fPointLongitude[iy*fNX+ix]; }
+
+    //! Latitude and longitude [deg] of the point on the ellipsoid below
+    //! easting and northing e,n [m] on the tangent plane
+    void toGeodetic(double e, double n,
+		    double& longitude, double& latitude) const;
+    //! Easting and northing [m] of the point on the tangent plane above
+    //! latitude and longitude [deg], the inverse of toGeodetic
+    void toLocal(double longitude, double latitude,
+		 double& e, double& n) const;
+
+    //! Metres per degree along the meridian and parallel at latitude
+    double meridianScale(double latitude_deg) const;
+    double parallelScale(double latitude_deg) const;
+
+  private:
+    double              fLongitude;
+    double              fLatitude;
+    unsigned            fNX;
+    unsigned            fNY;
+    double              fSpacing;
+    double              fA;
+    double              fE2;
+    double              fSinLat;    //!< of the tangent point
+    double              fCosLat;
+    double              fX0;        //!< tangent point, in a geocentric
+    double              fZ0;        //!< frame turned to its meridian
+    std::vector<double> fPointLatitude;
+    std::vector<double> fPointLongitude;
+  };
+
+  //! Resample a map onto a local grid with a separable kernel. Each
+  //! output row is cut into runs of points whose latitudes agree to
+  //! 1/64 of a map sample, which for grids of a few km is the whole row.
+  //! For each run the source rows are combined first, with one set of
+  //! weights, into a line of partial sums that the compiler vectorises;
+  //! the run's table of column weights is then applied to it. Kernels
+  //! are widened when the grid is coarser than the map so that they
+  //! average rather than alias. Voids are excluded and the weights
+  //! renormalised; points with less than half of the kernel weight on
+  //! valid samples are void. Rows are split across threads.
+  class DTEDResampler
+  {
+  public:
+    enum Kernel { K_BOX, K_BILINEAR, K_LANCZOS3 };
+
+    DTEDResampler(Kernel kernel = K_BILINEAR): fKernel(kernel) { }
+
+    Kernel kernel() const { return fKernel; }
+    static bool kernelByName(const std::string& name, Kernel& kernel);
+
+    //! Region of map pixels needed to resample onto grid
+    void footprint(const DTEDLocalGrid& grid, uint32_t resolution,
+		   int32_t& left, int32_t& bottom,
+		   unsigned& w, unsigned& h) const;
+
+    //! Resample, giving grid.nx()*grid.ny() values in rows from the south,
+    //! -32768 where void
+    void resample(const DTEDView& map, const DTEDLocalGrid& grid,
+		  std::vector<float>& out) const;
+
+  private:
+    double radius() const;
+    double weight(double t) const;
+    unsigned taps(double sigma) const;
+    void coefficients(double s, double sigma, unsigned ntap,
+		      int32_t& first, float* w) const;
+
+    Kernel fKernel;
+  };
+
+}
+
+#endif // DTEDRESAMPLE_HPP
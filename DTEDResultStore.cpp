@@ -0,0 +1,290 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file DTEDResultStore.cpp
+
+  Persistent per-tile store of selected pixels and their statistics, so
+  that only tiles whose inputs changed need to be recomputed
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+
+#include "DTED.hpp"
+#include "DTEDTileIndex.hpp"
+#include "DTEDResultStore.hpp"
+
+using namespace VERITAS;
+
+namespace
+{
+  const char MAGIC[8] = { 'D','T','E','D','R','E','S','2' };
+
+  template<typename T> void writeValue(std::ostream& stream, const T& x)
+  {
+    stream.write(reinterpret_cast<const char*>(&x), sizeof(x));
+  }
+
+  template<typename T> bool readValue(std::istream& stream, T& x)
+  {
+    return bool(stream.read(reinterpret_cast<char*>(&x), sizeof(x)));
+  }
+
+  template<typename T> void writeVector(std::ostream& stream,
+					const std::vector<T>& v)
+  {
+    uint32_t n = v.size();
+    writeValue(stream, n);
+    if(n)stream.write(reinterpret_cast<const char*>(&v.front()),
+		      n*sizeof(T));
+  }
+
+  template<typename T> bool readVector(std::istream& stream,
+				       std::vector<T>& v, uint32_t nmax)
+  {
+    uint32_t n;
+    if(!readValue(stream, n) || (n > nmax))return false;
+    v.resize(n);
+    return (n==0) ||
+      bool(stream.read(reinterpret_cast<char*>(&v.front()), n*sizeof(T)));
+  }
+}
+
+// ----------------------------------------------------------------------------
+// DTED Tile Result
+// ----------------------------------------------------------------------------
+
+void DTEDTileResult::reset(const DTEDTerrainStats& stats)
+{
+  fFlags         = stats.flags();
+  fWidth         = stats.width();
+  fHeight        = stats.height();
+  fLeft          = stats.left();
+  fBottom        = stats.bottom();
+  fResolution    = stats.resolution();
+  fFootprintSize = stats.footprintSize();
+  fPixels        = 0;
+  fArea          = 0;
+  fIndex.clear();
+  fCount.clear();
+  fMin.clear();
+  fMax.clear();
+  fMean.clear();
+  fStdDev.clear();
+  fMaxSlope.clear();
+  fResidual.clear();
+  fPctLow.clear();
+  fPctHigh.clear();
+}
+
+void DTEDTileResult::select(const DTEDTerrainStats& stats, unsigned k,
+			    double area)
+{
+  fPixels++;
+  fArea += area;
+  fIndex.push_back(k);
+  fCount.push_back(stats.fCount[k]);
+  if(fFlags & DTEDTerrainStats::S_RANGE)
+    fMin.push_back(stats.fMin[k]), fMax.push_back(stats.fMax[k]);
+  if(fFlags & DTEDTerrainStats::S_MEAN)fMean.push_back(stats.fMean[k]);
+  if(fFlags & DTEDTerrainStats::S_STDDEV)fStdDev.push_back(stats.fStdDev[k]);
+  if(fFlags & DTEDTerrainStats::S_SLOPE)fMaxSlope.push_back(stats.fMaxSlope[k]);
+  if(fFlags & DTEDTerrainStats::S_RESIDUAL)
+    fResidual.push_back(stats.fResidual[k]);
+  if(fFlags & DTEDTerrainStats::S_PERCENTILE)
+    fPctLow.push_back(stats.fPctLow[k]), fPctHigh.push_back(stats.fPctHigh[k]);
+}
+
+void DTEDTileResult::restore(DTEDTerrainStats& stats,
+			     std::vector<uint8_t>& mask) const
+{
+  const unsigned n = fWidth*fHeight;
+  stats.fFlags         = fFlags;
+  stats.fWidth         = fWidth;
+  stats.fHeight        = fHeight;
+  stats.fLeft          = fLeft;
+  stats.fBottom        = fBottom;
+  stats.fResolution    = fResolution;
+  stats.fFootprintSize = fFootprintSize;
+
+  // Unselected pixels get the values of a footprint with no valid samples
+  stats.fCount.assign(n, 0);
+  stats.fMin.assign((fFlags & DTEDTerrainStats::S_RANGE) ? n : 0, -32768);
+  stats.fMax.assign((fFlags & DTEDTerrainStats::S_RANGE) ? n : 0, -32768);
+  stats.fMean.assign((fFlags & DTEDTerrainStats::S_MEAN) ? n : 0, 0.0f);
+  stats.fStdDev.assign((fFlags & DTEDTerrainStats::S_STDDEV) ? n : 0, 0.0f);
+  stats.fMaxSlope.assign((fFlags & DTEDTerrainStats::S_SLOPE) ? n : 0, -1.0f);
+  stats.fResidual.assign((fFlags & DTEDTerrainStats::S_RESIDUAL) ? n : 0,
+			 0.0f);
+  stats.fPctLow.assign((fFlags & DTEDTerrainStats::S_PERCENTILE) ? n : 0,
+		       -32768);
+  stats.fPctHigh.assign((fFlags & DTEDTerrainStats::S_PERCENTILE) ? n : 0,
+			-32768);
+  mask.assign(n, 0);
+
+  for(unsigned i=0;i<fIndex.size();i++)
+    {
+      const unsigned k = fIndex[i];
+      mask[k] = 1;
+      stats.fCount[k] = fCount[i];
+      if(!fMin.empty())stats.fMin[k] = fMin[i], stats.fMax[k] = fMax[i];
+      if(!fMean.empty())stats.fMean[k] = fMean[i];
+      if(!fStdDev.empty())stats.fStdDev[k] = fStdDev[i];
+      if(!fMaxSlope.empty())stats.fMaxSlope[k] = fMaxSlope[i];
+      if(!fResidual.empty())stats.fResidual[k] = fResidual[i];
+      if(!fPctLow.empty())
+	stats.fPctLow[k] = fPctLow[i], stats.fPctHigh[k] = fPctHigh[i];
+    }
+}
+
+void DTEDTileResult::write(std::ostream& stream) const
+{
+  writeValue(stream, uint32_t(fFlags));
+  writeValue(stream, uint32_t(fWidth));
+  writeValue(stream, uint32_t(fHeight));
+  writeValue(stream, fLeft);
+  writeValue(stream, fBottom);
+  writeValue(stream, fResolution);
+  writeValue(stream, uint32_t(fFootprintSize));
+  writeValue(stream, fPixels);
+  writeValue(stream, fArea);
+  writeVector(stream, fIndex);
+  writeVector(stream, fCount);
+  writeVector(stream, fMin);
+  writeVector(stream, fMax);
+  writeVector(stream, fMean);
+  writeVector(stream, fStdDev);
+  writeVector(stream, fMaxSlope);
+  writeVector(stream, fResidual);
+  writeVector(stream, fPctLow);
+  writeVector(stream, fPctHigh);
+}
+
+bool DTEDTileResult::read(std::istream& stream)
+{
+  uint32_t flags;
+  uint32_t width;
+  uint32_t height;
+  uint32_t footprint_size;
+  if(!readValue(stream, flags) || !readValue(stream, width) ||
+     !readValue(stream, height) || !readValue(stream, fLeft) ||
+     !readValue(stream, fBottom) || !readValue(stream, fResolution) ||
+     !readValue(stream, footprint_size) || !readValue(stream, fPixels) ||
+     !readValue(stream, fArea))
+    return false;
+  fFlags         = flags;
+  fWidth         = width;
+  fHeight        = height;
+  fFootprintSize = footprint_size;
+
+  const uint32_t n = width*height;
+  if(!readVector(stream, fIndex, n) || !readVector(stream, fCount, n) ||
+     !readVector(stream, fMin, n) || !readVector(stream, fMax, n) ||
+     !readVector(stream, fMean, n) || !readVector(stream, fStdDev, n) ||
+     !readVector(stream, fMaxSlope, n) || !readVector(stream, fResidual, n) ||
+     !readVector(stream, fPctLow, n) || !readVector(stream, fPctHigh, n))
+    return false;
+
+  // Every stored array is either empty or has one entry per pixel
+  const size_t m = fIndex.size();
+  if((fCount.size()!=m)||(fMin.size()!=fMax.size())||
+     (!fMin.empty()&&fMin.size()!=m)||(!fMean.empty()&&fMean.size()!=m)||
+     (!fStdDev.empty()&&fStdDev.size()!=m)||
+     (!fMaxSlope.empty()&&fMaxSlope.size()!=m)||
+     (!fResidual.empty()&&fResidual.size()!=m)||
+     (fPctLow.size()!=fPctHigh.size())||(!fPctLow.empty()&&fPctLow.size()!=m))
+    return false;
+  for(size_t i=0;i<m;i++)if(fIndex[i] >= n)return false;
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// DTED Result Store
+// ----------------------------------------------------------------------------
+
+std::string DTEDResultStore::key(const DTEDTileIndex& index,
+				 int32_t longitude, int32_t latitude,
+				 const std::string& parameters)
+{
+  if(!index.valid() || (index.find(longitude, latitude) == 0))
+    return std::string();
+
+  std::ostringstream stream;
+  stream << parameters;
+  for(int32_t dy=-1;dy<=1;dy++)
+    for(int32_t dx=-1;dx<=1;dx++)
+      {
+	const int32_t x = DTEDMap::round(longitude+dx,1);
+	const int32_t y = latitude+dy;
+	const DTEDTileSummary* tile = index.find(x,y);
+	stream << ' ' << x << ',' << y << ':';
+	if(tile)stream << tile->fResolution << ',' << tile->fChecksum;
+	else stream << '-';
+      }
+  return stream.str();
+}
+
+std::string DTEDResultStore::filename(int32_t longitude, int32_t latitude) const
+{
+  std::string name = DTEDMap::srtmTileName(fDirectory, longitude, latitude);
+  return name.substr(0, name.rfind('.')) + std::string(".res");
+}
+
+bool DTEDResultStore::load(int32_t longitude, int32_t latitude,
+			   const std::string& key,
+			   std::vector<DTEDTileResult>& results) const
+{
+  std::ifstream stream(filename(longitude, latitude).c_str(),
+		       std::ios::in|std::ios::binary);
+  if(!stream)return false;
+
+  char magic[sizeof(MAGIC)];
+  if(!stream.read(magic, sizeof(magic)) ||
+     (memcmp(magic, MAGIC, sizeof(MAGIC))!=0))
+    return false;
+
+  uint32_t nkey;
+  if(!readValue(stream, nkey) || (nkey != key.size()))return false;
+  std::string stored_key(nkey, '\0');
+  if(nkey && !stream.read(&stored_key[0], nkey))return false;
+  if(stored_key != key)return false;
+
+  uint32_t nresult;
+  if(!readValue(stream, nresult))return false;
+  std::vector<DTEDTileResult> stored(nresult);
+  for(unsigned i=0;i<nresult;i++)
+    if(!stored[i].read(stream))return false;
+
+  results.swap(stored);
+  return true;
+}
+
+bool DTEDResultStore::save(int32_t longitude, int32_t latitude,
+			   const std::string& key,
+			   const std::vector<DTEDTileResult>& results) const
+{
+  std::string name = filename(longitude, latitude);
+  std::string tmp_name = name + std::string(".tmp");
+
+  std::ofstream stream(tmp_name.c_str(), std::ios::out|std::ios::binary);
+  if(!stream)return false;
+
+  stream.write(MAGIC, sizeof(MAGIC));
+  writeValue(stream, uint32_t(key.size()));
+  stream.write(key.data(), key.size());
+  writeValue(stream, uint32_t(results.size()));
+  for(unsigned i=0;i<results.size();i++)results[i].write(stream);
+  stream.close();
+  if(!stream)return false;
+
+  return rename(tmp_name.c_str(), name.c_str()) == 0;
+}
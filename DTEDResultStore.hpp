@@ -0,0 +1,109 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file DTEDResultStore.hpp
+
+  Persistent per-tile store of selected pixels and their statistics, so
+  that only tiles whose inputs changed need to be recomputed
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#ifndef DTEDRESULTSTORE_HPP
+#define DTEDRESULTSTORE_HPP
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <stdint.h>
+
+#include "DTEDStats.hpp"
+
+//! VERITAS namespace
+namespace VERITAS
+{
+
+  class DTEDTileIndex;
+
+  //! Pixels of one tile that pass a selection, with their footprint
+  //! statistics. Holds everything needed to reproduce the per-pixel
+  //! output, the totals and the region labelling without the map.
+  class DTEDTileResult
+  {
+  public:
+    DTEDTileResult():
+      fFlags(), fWidth(), fHeight(), fLeft(), fBottom(), fResolution(),
+      fFootprintSize(), fPixels(), fArea(), fIndex(), fCount(), fMin(),
+      fMax(), fMean(), fStdDev(), fMaxSlope(), fResidual(), fPctLow(),
+      fPctHigh() { }
+
+    //! Take the geometry of the stats and clear the selection
+    void reset(const DTEDTerrainStats& stats);
+    //! Add pixel k of the stats to the selection
+    void select(const DTEDTerrainStats& stats, unsigned k, double area);
+    //! Rebuild stats and selection mask as they were when selected
+    void restore(DTEDTerrainStats& stats, std::vector<uint8_t>& mask) const;
+
+    void write(std::ostream& stream) const;
+    bool read(std::istream& stream);
+
+    unsigned                fFlags;
+    unsigned                fWidth;
+    unsigned                fHeight;
+    int32_t                 fLeft;
+    int32_t                 fBottom;
+    uint32_t                fResolution;
+    unsigned                fFootprintSize;
+
+    uint64_t                fPixels;
+    double                  fArea;       //!< m^2
+
+    std::vector<uint32_t>   fIndex;      //!< pixel index in the stats
+    std::vector<uint32_t>   fCount;
+    std::vector<int16_t>    fMin;
+    std::vector<int16_t>    fMax;
+    std::vector<float>      fMean;
+    std::vector<float>      fStdDev;
+    std::vector<float>      fMaxSlope;
+    std::vector<float>      fResidual;
+    std::vector<int16_t>    fPctLow;
+    std::vector<int16_t>    fPctHigh;
+  };
+
+  //! Directory of result files, one per tile. Each is stored with a key
+  //! made of the parameters and the checksums of the tile and its eight
+  //! neighbours from the tile index, so a result is reused only if none
+  //! of the data within reach of the tile's footprints has changed.
+  class DTEDResultStore
+  {
+  public:
+    DTEDResultStore(const std::string& directory): fDirectory(directory) { }
+
+    const std::string& directory() const { return fDirectory; }
+
+    //! Key for the tile, or empty if the index does not have the tile
+    static std::string key(const DTEDTileIndex& index,
+			   int32_t longitude, int32_t latitude,
+			   const std::string& parameters);
+
+    //! Read the results for the tile if they were stored under this key
+    bool load(int32_t longitude, int32_t latitude, const std::string& key,
+	      std::vector<DTEDTileResult>& results) const;
+    //! Write the results for the tile (atomically, via a temporary file)
+    bool save(int32_t longitude, int32_t latitude, const std::string& key,
+	      const std::vector<DTEDTileResult>& results) const;
+
+    std::string filename(int32_t longitude, int32_t latitude) const;
+
+  private:
+    std::string fDirectory;
+  };
+
+}
+
+#endif // DTEDRESULTSTORE_HPP
@@ -0,0 +1,479 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file DTEDStats.cpp
+
+  Fused single-pass terrain statistics over a circular footprint
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#include <iostream>
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+
+#include "DTEDStats.hpp"
+#include "DTEDParallel.hpp"
+
+using namespace VERITAS;
+
+// ----------------------------------------------------------------------------
+// DTED Footprint
+// ----------------------------------------------------------------------------
+
+DTEDFootprint::DTEDFootprint(double radius, double scale_x, double scale_y):
+  fRadius(radius), fScaleX(scale_x), fScaleY(scale_y),
+  fNY(), fNX(), fSize(), fHalfWidth()
+{
+  // Same disc as the original find_flat search: all pixels whose centre
+  // is within "radius" of the central pixel
+  int ny = int(ceil(radius/scale_y))+1;
+  int nx = int(ceil(radius/scale_x))+1;
+
+  std::vector<int> half_width(2*ny+1, -1);
+  for(int iy=-ny;iy<=ny;iy++)
+    {
+      double delta_y = double(iy)*scale_y;
+      for(int ix=0;ix<=nx;ix++)
+	{
+	  double delta_x = double(ix)*scale_x;
+	  if(sqrt(delta_x*delta_x+delta_y*delta_y)<=radius)
+	    half_width[iy+ny] = ix;
+	}
+    }
+
+  while((ny>0)&&(half_width[0]<0)&&(half_width[2*ny]<0))
+    {
+      half_width.erase(half_width.begin());
+      half_width.pop_back();
+      ny--;
+    }
+
+  fNY = ny;
+  fHalfWidth = half_width;
+  for(int iy=-ny;iy<=ny;iy++)
+    {
+      assert(halfWidth(iy) >= 0);
+      fNX = std::max(fNX, halfWidth(iy));
+      fSize += 2*halfWidth(iy)+1;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// DTED Terrain Statistics
+// ----------------------------------------------------------------------------
+
+namespace
+{
+  const int32_t VOID = -32768;
+
+  // Per-row accumulators for one band. Every array is indexed by output
+  // column so that the inner loops run over contiguous memory and can be
+  // vectorized by the compiler. The sums are 64-bit: over a large
+  // footprint a sum of elevations, or of squared offsets, passes 2^31.
+  class RowAccumulator
+  {
+  public:
+    void reset(unsigned n)
+    {
+      cnt.assign(n,0);
+      mn.assign(n,32767);
+      mx.assign(n,-32768);
+      sz.assign(n,0);
+      szz.assign(n,0);
+      sxz.assign(n,0);
+      syz.assign(n,0);
+      sx.assign(n,0);
+      sy.assign(n,0);
+      sxx.assign(n,0);
+      syy.assign(n,0);
+      sxy.assign(n,0);
+      slope.assign(n,-1.0f);
+    }
+
+    std::vector<uint32_t> cnt;
+    std::vector<int16_t>  mn;
+    std::vector<int16_t>  mx;
+    std::vector<int64_t>  sz;
+    std::vector<int64_t>  szz;
+    std::vector<int64_t>  sxz;
+    std::vector<int64_t>  syz;
+    std::vector<int64_t>  sx;
+    std::vector<int64_t>  sy;
+    std::vector<int64_t>  sxx;
+    std::vector<int64_t>  syy;
+    std::vector<int64_t>  sxy;
+    std::vector<float>    slope;
+  };
+
+  // Accumulate one footprint offset (ix,iy) for a full row of output
+  // pixels. The statistics are compile-time switches so the loop body
+  // holds only what was asked for and there are no per-sample branches.
+  template<bool RANGE, bool MOMENTS, bool PLANE>
+  void accumulateOffset(const int16_t* __restrict src, unsigned n,
+			int32_t ix, int32_t iy, RowAccumulator& a)
+  {
+    uint32_t* __restrict cnt = &a.cnt[0];
+    int16_t*  __restrict mn  = &a.mn[0];
+    int16_t*  __restrict mx  = &a.mx[0];
+    int64_t*  __restrict sz  = &a.sz[0];
+    int64_t*  __restrict szz = &a.szz[0];
+    int64_t*  __restrict sxz = &a.sxz[0];
+    int64_t*  __restrict syz = &a.syz[0];
+    int64_t*  __restrict sx  = &a.sx[0];
+    int64_t*  __restrict sy  = &a.sy[0];
+    int64_t*  __restrict sxx = &a.sxx[0];
+    int64_t*  __restrict syy = &a.syy[0];
+    int64_t*  __restrict sxy = &a.sxy[0];
+
+    for(unsigned i=0;i<n;i++)
+      {
+	const int32_t el = src[i];
+	const int32_t v  = (el != VOID);
+	const int32_t z  = v ? el : 0;
+	cnt[i] += v;
+	if(RANGE)
+	  {
+	    mn[i] = std::min(int32_t(mn[i]), v ? el : int32_t(32767));
+	    mx[i] = std::max(int32_t(mx[i]), el);
+	  }
+	if(MOMENTS)
+	  {
+	    sz[i]  += int64_t(z);
+	    szz[i] += int64_t(z*z);
+	  }
+	if(PLANE)
+	  {
+	    sxz[i] += int64_t(ix*z);
+	    syz[i] += int64_t(iy*z);
+	    sx[i]  += int64_t(ix*v);
+	    sy[i]  += int64_t(iy*v);
+	    sxx[i] += int64_t(ix*ix*v);
+	    syy[i] += int64_t(iy*iy*v);
+	    sxy[i] += int64_t(ix*iy*v);
+	  }
+      }
+  }
+
+  typedef void (*AccumulateFn)(const int16_t*, unsigned, int32_t, int32_t,
+			       RowAccumulator&);
+
+  AccumulateFn accumulateFn(bool range, bool moments, bool plane)
+  {
+    static const AccumulateFn fn[8] = {
+      &accumulateOffset<false,false,false>,
+      &accumulateOffset<false,false,true>,
+      &accumulateOffset<false,true,false>,
+      &accumulateOffset<false,true,true>,
+      &accumulateOffset<true,false,false>,
+      &accumulateOffset<true,false,true>,
+      &accumulateOffset<true,true,false>,
+      &accumulateOffset<true,true,true> };
+    return fn[(range?4:0)+(moments?2:0)+(plane?1:0)];
+  }
+
+  // Horn gradient magnitude (rise over run) along map row y for columns
+  // [x0,x0+n), or -1 where any of the 3x3 neighbourhood is void
+  void hornGradientRow(const DTEDView& map,
+		       unsigned x0, unsigned y, unsigned n,
+		       double scale_x, double scale_y, float* g)
+  {
+    const int16_t* rs = &map.datum(x0-1,y-1);
+    const int16_t* r0 = &map.datum(x0-1,y);
+    const int16_t* rn = &map.datum(x0-1,y+1);
+    const float cx = float(1.0/(8.0*scale_x));
+    const float cy = float(1.0/(8.0*scale_y));
+    for(unsigned i=0;i<n;i++)
+      {
+	const int32_t a = rn[i], b = rn[i+1], c = rn[i+2];
+	const int32_t d = r0[i],              f = r0[i+2];
+	const int32_t p = rs[i], q = rs[i+1], r = rs[i+2];
+	const bool valid =
+	  (a!=VOID)&&(b!=VOID)&&(c!=VOID)&&(d!=VOID)&&(r0[i+1]!=VOID)&&
+	  (f!=VOID)&&(p!=VOID)&&(q!=VOID)&&(r!=VOID);
+	const float gx = float((c+2*f+r)-(a+2*d+p))*cx;
+	const float gy = float((a+2*b+c)-(p+2*q+r))*cy;
+	g[i] = valid ? std::sqrt(gx*gx+gy*gy) : -1.0f;
+      }
+  }
+
+  // Histogram of the elevations in the footprint as it slides along a
+  // row (Huang et al.). One count per elevation, with a count per block
+  // of 256 elevations so that empty stretches are stepped over. Each
+  // percentile is tracked as an elevation and the number of samples
+  // below it; adding or removing a sample only updates that number, and
+  // the tracker is then walked to the new rank. Between neighbouring
+  // footprints the percentiles move by a few metres, so the walk is
+  // short and the cost per pixel is set by the samples entering and
+  // leaving the footprint rather than by its area.
+  class SlidingHistogram
+  {
+  public:
+    SlidingHistogram(): fBin(65536), fBlock(256), fCount(), fTracker() { }
+
+    void add(int16_t z)
+    {
+      if(z==VOID)return;
+      const unsigned b = unsigned(int32_t(z)-VOID);
+      fBin[b]++;
+      fBlock[b>>8]++;
+      fCount++;
+      for(unsigned i=0;i<2;i++)if(b<fTracker[i].fBin)fTracker[i].fBelow++;
+    }
+
+    void remove(int16_t z)
+    {
+      if(z==VOID)return;
+      const unsigned b = unsigned(int32_t(z)-VOID);
+      fBin[b]--;
+      fBlock[b>>8]--;
+      fCount--;
+      for(unsigned i=0;i<2;i++)if(b<fTracker[i].fBin)fTracker[i].fBelow--;
+    }
+
+    uint32_t count() const { return fCount; }
+
+    //! Elevation with given number of samples below it (nearest rank),
+    //! using tracker i
+    int16_t select(unsigned i, uint32_t rank)
+    {
+      Tracker& t = fTracker[i];
+      while(t.fBelow > rank)
+	{
+	  if(((t.fBin&0xFF)==0)&&(fBlock[(t.fBin-1)>>8]==0))t.fBin -= 256;
+	  else t.fBelow -= fBin[--t.fBin];
+	}
+      while(t.fBelow+fBin[t.fBin] <= rank)
+	{
+	  if(((t.fBin&0xFF)==0)&&(fBlock[t.fBin>>8]==0))t.fBin += 256;
+	  else t.fBelow += fBin[t.fBin++];
+	}
+      return int16_t(int32_t(t.fBin)+VOID);
+    }
+
+  private:
+    struct Tracker
+    {
+      unsigned fBin;
+      uint32_t fBelow;
+    };
+
+    std::vector<uint32_t> fBin;
+    std::vector<uint32_t> fBlock;
+    uint32_t              fCount;
+    Tracker               fTracker[2];
+  };
+
+  // Low and high percentile elevations for a row of n output pixels
+  // starting at map pixel (x0,y). The histogram is empty on entry and
+  // is left empty for the next row.
+  void percentileRow(const DTEDView& map, const DTEDFootprint& footprint,
+		     unsigned x0, unsigned y, unsigned n,
+		     double low_fraction, double high_fraction,
+		     SlidingHistogram& h, int16_t* lo, int16_t* hi)
+  {
+    const int ny = footprint.ny();
+    for(int iy=-ny;iy<=ny;iy++)
+      {
+	const int hw = footprint.halfWidth(iy);
+	const int16_t* row = &map.datum(x0,y+iy);
+	for(int ix=-hw;ix<=hw;ix++)h.add(row[ix]);
+      }
+
+    for(unsigned i=0;i<n;i++)
+      {
+	if(i)
+	  for(int iy=-ny;iy<=ny;iy++)
+	    {
+	      const int hw = footprint.halfWidth(iy);
+	      const int16_t* row = &map.datum(x0+i,y+iy);
+	      h.remove(row[-hw-1]);
+	      h.add(row[hw]);
+	    }
+
+	const uint32_t count = h.count();
+	if(count == 0)
+	  {
+	    lo[i] = hi[i] = int16_t(VOID);
+	    continue;
+	  }
+	const double last = double(count-1);
+	lo[i] = h.select(0, uint32_t(floor(low_fraction*last+0.5)));
+	hi[i] = h.select(1, uint32_t(floor(high_fraction*last+0.5)));
+      }
+
+    for(int iy=-ny;iy<=ny;iy++)
+      {
+	const int hw = footprint.halfWidth(iy);
+	const int16_t* row = &map.datum(x0+n-1,y+iy);
+	for(int ix=-hw;ix<=hw;ix++)h.remove(row[ix]);
+      }
+  }
+}
+
+bool DTEDTerrainStats::compute(const DTEDView& map,
+			       const DTEDFootprint& footprint,
+			       unsigned x0, unsigned y0,
+			       unsigned x1, unsigned y1,
+			       unsigned flags,
+			       double low_percentile, double high_percentile)
+{
+  assert((x1>=x0)&&(y1>=y0));
+
+  // The kernels read footprint+1 pixels around the region unchecked
+  const int nx = footprint.nx();
+  const int ny = footprint.ny();
+  if((x0 < unsigned(nx+1))||(y0 < unsigned(ny+1))||
+     (x1+unsigned(nx+1) > map.width())||(y1+unsigned(ny+1) > map.height()))
+    {
+      std::cerr << "DTEDTerrainStats: footprint of " << 2*nx+1 << " x "
+		<< 2*ny+1 << " pixels does not fit in the map" << std::endl;
+      fWidth = fHeight = 0;
+      return false;
+    }
+
+  fFlags         = flags;
+  fWidth         = x1-x0;
+  fHeight        = y1-y0;
+  fLeft          = map.xCoordOf(x0);
+  fBottom        = map.yCoordOf(y0);
+  fResolution    = map.resolution();
+  fFootprintSize = footprint.size();
+
+  const unsigned npix = fWidth*fHeight;
+  const bool range    = flags & S_RANGE;
+  const bool moments  = flags & (S_MEAN|S_STDDEV|S_RESIDUAL);
+  const bool plane    = flags & S_RESIDUAL;
+  const bool slope    = flags & S_SLOPE;
+  const bool pct      = flags & S_PERCENTILE;
+
+  fCount.resize(npix);
+  fMin.resize(range ? npix : 0);
+  fMax.resize(range ? npix : 0);
+  fMean.resize((flags & S_MEAN) ? npix : 0);
+  fStdDev.resize((flags & S_STDDEV) ? npix : 0);
+  fMaxSlope.resize(slope ? npix : 0);
+  fResidual.resize(plane ? npix : 0);
+  fPctLow.resize(pct ? npix : 0);
+  fPctHigh.resize(pct ? npix : 0);
+
+  if(npix == 0)return true;
+
+  AccumulateFn accumulate = accumulateFn(range, moments, plane);
+
+#pragma omp parallel
+  {
+    unsigned band_begin;
+    unsigned band_end;
+    dtedThreadBand(fHeight, band_begin, band_end);
+
+    RowAccumulator a;
+    std::vector<SlidingHistogram> hist(pct ? 1 : 0);
+
+    // Ring buffer of Horn gradient rows covering the footprint rows of
+    // the current output row, extended by nx on either side
+    const unsigned nring = slope ? 2*ny+1 : 0;
+    const unsigned gw    = fWidth+2*nx;
+    std::vector<float> gradient(nring*gw);
+    int32_t grad_next = int32_t(y0+band_begin)-ny;
+
+    for(unsigned oy=band_begin; oy<band_end; oy++)
+      {
+	const unsigned y = y0+oy;
+	a.reset(fWidth);
+
+	for(int iy=-ny;iy<=ny;iy++)
+	  {
+	    const int hw = footprint.halfWidth(iy);
+	    const int16_t* row = &map.datum(x0,y+iy);
+	    for(int ix=-hw;ix<=hw;ix++)
+	      accumulate(row+ix, fWidth, ix, iy, a);
+	  }
+
+	if(slope)
+	  {
+	    for(;grad_next<=int32_t(y)+ny;grad_next++)
+	      hornGradientRow(map, x0-nx, unsigned(grad_next), gw,
+			      footprint.scaleX(), footprint.scaleY(),
+			      &gradient[(unsigned(grad_next)%nring)*gw]);
+
+	    float* __restrict ms = &a.slope[0];
+	    for(int iy=-ny;iy<=ny;iy++)
+	      {
+		const int hw = footprint.halfWidth(iy);
+		const float* g = &gradient[((y+iy)%nring)*gw+nx];
+		for(int ix=-hw;ix<=hw;ix++)
+		  {
+		    const float* __restrict gx = g+ix;
+		    for(unsigned i=0;i<fWidth;i++)
+		      ms[i] = std::max(ms[i], gx[i]);
+		  }
+	      }
+	  }
+
+	const unsigned k0 = oy*fWidth;
+	if(pct)
+	  percentileRow(map, footprint, x0, y, fWidth,
+			low_percentile/100.0, high_percentile/100.0,
+			hist.front(), &fPctLow[k0], &fPctHigh[k0]);
+
+	for(unsigned i=0;i<fWidth;i++)
+	  {
+	    const unsigned k = k0+i;
+	    const uint32_t n = a.cnt[i];
+	    fCount[k] = n;
+
+	    if(range)
+	      {
+		fMin[k] = n ? a.mn[i] : int16_t(VOID);
+		fMax[k] = a.mx[i];
+	      }
+
+	    if(slope)
+	      fMaxSlope[k] = (a.slope[i]<0) ? -1.0f :
+		float(atan(a.slope[i])/M_PI*180.0);
+
+	    if(!moments)continue;
+
+	    const double dn   = double(n);
+	    const double mean = n ? double(a.sz[i])/dn : 0.0;
+	    const double czz  = n ? double(a.szz[i])-double(a.sz[i])*mean : 0.0;
+
+	    if(flags & S_MEAN)fMean[k] = float(mean);
+	    if(flags & S_STDDEV)
+	      fStdDev[k] = n ? float(sqrt(std::max(czz,0.0)/dn)) : 0.0f;
+
+	    if(plane)
+	      {
+		// Least-squares plane fit in centred coordinates; residual
+		// is independent of the horizontal pixel scale
+		double rss = czz;
+		if(n >= 3)
+		  {
+		    const double cxx = a.sxx[i] - double(a.sx[i])*a.sx[i]/dn;
+		    const double cyy = a.syy[i] - double(a.sy[i])*a.sy[i]/dn;
+		    const double cxy = a.sxy[i] - double(a.sx[i])*a.sy[i]/dn;
+		    const double cxz = a.sxz[i] - double(a.sx[i])*mean;
+		    const double cyz = a.syz[i] - double(a.sy[i])*mean;
+		    const double det = cxx*cyy-cxy*cxy;
+		    if(det > 0)
+		      {
+			const double bx = ( cyy*cxz-cxy*cyz)/det;
+			const double by = (-cxy*cxz+cxx*cyz)/det;
+			rss = czz-bx*cxz-by*cyz;
+		      }
+		  }
+		fResidual[k] = n ? float(sqrt(std::max(rss,0.0)/dn)) : 0.0f;
+	      }
+	  }
+      }
+  }
+
+  return true;
+}
@@ -0,0 +1,115 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file DTEDStats.hpp
+
+  Fused single-pass terrain statistics over a circular footprint
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#ifndef DTEDSTATS_HPP
+#define DTEDSTATS_HPP
+
+#include <vector>
+#include <stdint.h>
+
+#include "DTED.hpp"
+
+//! VERITAS namespace
+namespace VERITAS
+{
+
+  //! Circular footprint of given radius on a grid of given pixel scale.
+  //! Stored as one symmetric span [-halfWidth(iy),halfWidth(iy)] per row.
+  class DTEDFootprint
+  {
+  public:
+    DTEDFootprint(double radius, double scale_x, double scale_y);
+
+    int ny() const { return fNY; }
+    int nx() const { return fNX; }
+    int halfWidth(int iy) const { return fHalfWidth[iy+fNY]; }
+    unsigned size() const { return fSize; }
+
+    double radius() const { return fRadius; }
+    double scaleX() const { return fScaleX; }
+    double scaleY() const { return fScaleY; }
+
+  private:
+    double           fRadius;
+    double           fScaleX;
+    double           fScaleY;
+    int              fNY;
+    int              fNX;
+    unsigned         fSize;
+    std::vector<int> fHalfWidth;
+  };
+
+  //! Structure-of-arrays statistics for every pixel of a rectangular
+  //! region of a map. Only the arrays selected by the flags are filled.
+  class DTEDTerrainStats
+  {
+  public:
+    enum Statistic { S_RANGE      = 0x01,  //!< min and max elevation
+		     S_MEAN       = 0x02,  //!< mean elevation
+		     S_STDDEV     = 0x04,  //!< RMS about the mean
+		     S_SLOPE      = 0x08,  //!< max Horn slope [deg]
+		     S_RESIDUAL   = 0x10,  //!< RMS about best-fit plane
+		     S_ALL        = 0x1F,
+		     S_PERCENTILE = 0x20   //!< low and high percentile elevation
+    };
+
+    DTEDTerrainStats():
+      fFlags(), fWidth(), fHeight(), fLeft(), fBottom(), fResolution(),
+      fFootprintSize(), fCount(), fMin(), fMax(), fMean(), fStdDev(),
+      fMaxSlope(), fResidual(), fPctLow(), fPctHigh() { }
+
+    //! Compute statistics for map pixels [x0,x1) x [y0,y1). The map
+    //! must extend at least footprint+1 pixels beyond the region; if it
+    //! does not nothing is computed and false is returned. With
+    //! S_PERCENTILE the elevations at the low and high percentiles of
+    //! each footprint are found too (nearest rank, voids excluded). They
+    //! are not part of S_ALL.
+    bool compute(const DTEDView& map, const DTEDFootprint& footprint,
+		 unsigned x0, unsigned y0, unsigned x1, unsigned y1,
+		 unsigned flags = S_ALL,
+		 double low_percentile = 2.0, double high_percentile = 98.0);
+
+    unsigned width() const { return fWidth; }
+    unsigned height() const { return fHeight; }
+    int32_t left() const { return fLeft; }
+    int32_t bottom() const { return fBottom; }
+    uint32_t resolution() const { return fResolution; }
+    unsigned flags() const { return fFlags; }
+    unsigned footprintSize() const { return fFootprintSize; }
+
+    unsigned index(unsigned x, unsigned y) const { return y*fWidth+x; }
+
+    unsigned                fFlags;
+    unsigned                fWidth;
+    unsigned                fHeight;
+    int32_t                 fLeft;
+    int32_t                 fBottom;
+    uint32_t                fResolution;
+    unsigned                fFootprintSize;
+
+    std::vector<uint32_t>   fCount;      //!< non-void samples in footprint
+    std::vector<int16_t>    fMin;        //!< -32768 if no valid samples
+    std::vector<int16_t>    fMax;
+    std::vector<float>      fMean;
+    std::vector<float>      fStdDev;
+    std::vector<float>      fMaxSlope;   //!< degrees, -1 if undefined
+    std::vector<float>      fResidual;
+    std::vector<int16_t>    fPctLow;     //!< -32768 if no valid samples
+    std::vector<int16_t>    fPctHigh;
+  };
+
+}
+
+#endif // DTEDSTATS_HPP
@@ -0,0 +1,222 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file DTEDTileIndex.cpp
+
+  Persistent per-directory index of SRTM tile availability and summary
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+#include <zlib.h>
+
+#include "DTED.hpp"
+#include "DTEDTileIndex.hpp"
+#include "DTEDTileReader.hpp"
+
+using namespace VERITAS;
+
+std::string DTEDTileIndex::indexFilename() const
+{
+  if(fDirectory.empty())return std::string(DTED_TILE_INDEX_FILE);
+  return fDirectory + std::string("/") + std::string(DTED_TILE_INDEX_FILE);
+}
+
+bool DTEDTileIndex::load()
+{
+  fTiles.clear();
+  fValid = false;
+
+  std::ifstream stream(indexFilename().c_str());
+  if(!stream)return false;
+
+  std::string line;
+  while(std::getline(stream, line))
+    {
+      if(line.empty() || line[0]=='#')continue;
+      std::istringstream ls(line);
+      DTEDTileSummary tile;
+      int32_t min;
+      int32_t max;
+      ls >> tile.fFilename >> tile.fLongitude >> tile.fLatitude
+	 >> tile.fFileSize >> tile.fMTime >> tile.fResolution
+	 >> min >> max >> tile.fVoids;
+      if(!ls)continue;
+      // Indexes written before checksums were added: keep the entry but
+      // make the next update re-read the tile
+      if(!(ls >> tile.fChecksum))tile.fChecksum = 0, tile.fMTime = -1;
+      tile.fMin = int16_t(min);
+      tile.fMax = int16_t(max);
+      fTiles[Key(tile.fLongitude, tile.fLatitude)] = tile;
+    }
+
+  fValid = true;
+  return true;
+}
+
+bool DTEDTileIndex::save() const
+{
+  std::string filename = indexFilename();
+  std::string tmp_filename = filename + std::string(".tmp");
+
+  std::ofstream stream(tmp_filename.c_str());
+  if(!stream)return false;
+
+  stream << "# filename longitude latitude size mtime resolution "
+	 << "min max voids crc" << std::endl;
+  for(TileMap::const_iterator i = fTiles.begin(); i!=fTiles.end(); i++)
+    stream << i->second.fFilename << ' '
+	   << i->second.fLongitude << ' '
+	   << i->second.fLatitude << ' '
+	   << i->second.fFileSize << ' '
+	   << i->second.fMTime << ' '
+	   << i->second.fResolution << ' '
+	   << i->second.fMin << ' '
+	   << i->second.fMax << ' '
+	   << i->second.fVoids << ' '
+	   << i->second.fChecksum << std::endl;
+  stream.close();
+  if(!stream)return false;
+
+  return rename(tmp_filename.c_str(), filename.c_str()) == 0;
+}
+
+unsigned DTEDTileIndex::update(bool full)
+{
+  DIR* dir = opendir(fDirectory.empty() ? "." : fDirectory.c_str());
+  if(!dir)return 0;
+
+  TileMap tiles;
+  std::vector<DTEDTileSummary*> to_read;
+
+  while(struct dirent* entry = readdir(dir))
+    {
+      std::string name(entry->d_name);
+      int32_t longitude;
+      int32_t latitude;
+      if(!DTEDMap::parseSRTMTileName(name, longitude, latitude))continue;
+
+      // A tile present both raw and compressed is read from the raw file,
+      // and one both gzipped and zipped from the gzipped file
+      Key key(longitude, latitude);
+      TileMap::const_iterator have = tiles.find(key);
+      if((have != tiles.end()) &&
+	 (DTEDTileReader::formatOf(have->second.fFilename) <
+	  DTEDTileReader::formatOf(name)))
+	continue;
+
+      std::string path = name;
+      if(!fDirectory.empty())path = fDirectory + std::string("/") + name;
+      struct stat st;
+      if((stat(path.c_str(), &st) != 0)||(!S_ISREG(st.st_mode)))continue;
+
+      DTEDTileSummary tile;
+      tile.fLongitude = longitude;
+      tile.fLatitude  = latitude;
+      tile.fFilename  = name;
+      tile.fFileSize  = st.st_size;
+      // Nanoseconds, so a tile replaced within a second of being indexed
+      // is still noticed
+      tile.fMTime     = int64_t(st.st_mtim.tv_sec)*1000000000 +
+	int64_t(st.st_mtim.tv_nsec);
+
+      // Tiles are (res+1)^2 big-endian 16-bit samples, whose number for
+      // compressed tiles is in the gzip trailer or the zip header
+      const uint64_t bytes = DTEDTileReader::dataSize(path);
+      uint32_t n = uint32_t(floor(sqrt(double(bytes/2))+0.5));
+      if((n<2)||(uint64_t(n)*n*2 != bytes))continue;
+      tile.fResolution = n-1;
+
+      tiles[key] = tile;
+    }
+  closedir(dir);
+
+  for(TileMap::iterator i = tiles.begin(); i != tiles.end(); ++i)
+    {
+      TileMap::const_iterator old = fTiles.find(i->first);
+      if(!full && (old != fTiles.end()) &&
+	 (old->second.fFilename == i->second.fFilename) &&
+	 (old->second.fFileSize == i->second.fFileSize) &&
+	 (old->second.fMTime == i->second.fMTime))
+	i->second = old->second;
+      else
+	to_read.push_back(&i->second);
+    }
+
+  // Reading tiles dominates, and on network filesystems benefits from
+  // having several requests in flight
+#pragma omp parallel for schedule(dynamic)
+  for(int i=0;i<int(to_read.size());i++)
+    {
+      DTEDTileSummary* tile = to_read[i];
+      std::string path = tile->fFilename;
+      if(!fDirectory.empty())path = fDirectory + std::string("/") + path;
+      const int32_t res = int32_t(tile->fResolution);
+      DTEDMapPtr map = DTEDMap::loadMap(path, res+1, res+1,
+					tile->fLongitude*res,
+					tile->fLatitude*res, tile->fResolution);
+      if(!map)
+	{
+	  // Leave no entry, so the tile is neither pruned as void nor
+	  // skipped by the next update, which tries it again
+	  tile->fResolution = 0;
+	  continue;
+	}
+      const unsigned n = map->width()*map->height();
+      const int16_t* data = map->data();
+      for(unsigned j=0;j<n;j++)
+	if(data[j] == -32768)tile->fVoids++;
+	else
+	  {
+	    if((tile->fMin==-32768)||(data[j]<tile->fMin))tile->fMin=data[j];
+	    if((tile->fMax==-32768)||(data[j]>tile->fMax))tile->fMax=data[j];
+	  }
+      tile->fChecksum = crc32(crc32(0L, Z_NULL, 0),
+			      reinterpret_cast<const Bytef*>(data),
+			      n*sizeof(*data));
+    }
+
+  for(TileMap::iterator i = tiles.begin(); i != tiles.end(); )
+    if(i->second.fResolution == 0)
+      {
+	std::cerr << "DTEDTileIndex: could not read "
+		  << i->second.fFilename << ", not indexed" << std::endl;
+	tiles.erase(i++);
+      }
+    else ++i;
+
+  fTiles.swap(tiles);
+  fValid = true;
+  return to_read.size();
+}
+
+const DTEDTileSummary*
+DTEDTileIndex::find(int32_t longitude, int32_t latitude) const
+{
+  TileMap::const_iterator i = fTiles.find(Key(longitude, latitude));
+  if(i == fTiles.end())return 0;
+  return &i->second;
+}
+
+bool DTEDTileIndex::mayReach(int32_t longitude, int32_t latitude,
+			     int16_t elevation) const
+{
+  if(!fValid)return true;
+  const DTEDTileSummary* tile = find(longitude, latitude);
+  return (tile != 0)&&(tile->fMax >= elevation);
+}
@@ -0,0 +1,97 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file DTEDTileIndex.hpp
+
+  Persistent per-directory index of SRTM tile availability and summary
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#ifndef DTEDTILEINDEX_HPP
+#define DTEDTILEINDEX_HPP
+
+#include <string>
+#include <map>
+#include <stdint.h>
+
+#define DTED_TILE_INDEX_FILE "DTEDIndex.txt"
+
+//! VERITAS namespace
+namespace VERITAS
+{
+
+  //! Summary of one tile file, identified by the degree coordinates of its
+  //! bottom-left corner
+  class DTEDTileSummary
+  {
+  public:
+    DTEDTileSummary():
+      fLongitude(), fLatitude(), fFilename(), fFileSize(), fMTime(),
+      fResolution(), fMin(-32768), fMax(-32768), fVoids(), fChecksum() { }
+
+    int32_t     fLongitude;
+    int32_t     fLatitude;
+    std::string fFilename;     //!< relative to the indexed directory
+    uint64_t    fFileSize;
+    int64_t     fMTime;        //!< ns since the epoch
+    uint32_t    fResolution;   //!< samples per degree
+    int16_t     fMin;          //!< -32768 if tile is entirely void
+    int16_t     fMax;
+    uint32_t    fVoids;
+    uint32_t    fChecksum;     //!< CRC-32 of the samples
+  };
+
+  //! Index of all tiles present in one directory, stored in the directory
+  //! itself. Only present tiles have entries: once an index has been
+  //! loaded, a tile with no entry is known to be absent and need not be
+  //! probed on disk.
+  class DTEDTileIndex
+  {
+  public:
+    DTEDTileIndex(const std::string& directory):
+      fDirectory(directory), fValid(false), fTiles() { }
+
+    const std::string& directory() const { return fDirectory; }
+    bool valid() const { return fValid; }
+    unsigned size() const { return fTiles.size(); }
+
+    //! Read the index file, returns false if there is none
+    bool load();
+    //! Write the index file (atomically, via a temporary file)
+    bool save() const;
+    //! Scan the directory, re-reading only tiles whose size or
+    //! modification time differs from the index (or all if full is set).
+    //! Returns the number of tiles read.
+    unsigned update(bool full = false);
+
+    //! Summary for tile, or 0 if absent (or if the index is not valid)
+    const DTEDTileSummary* find(int32_t longitude, int32_t latitude) const;
+
+    //! False only if the index is valid and says the tile is absent
+    bool mayHaveTile(int32_t longitude, int32_t latitude) const
+    { return !fValid || find(longitude, latitude)!=0; }
+
+    //! False only if the index is valid and says the tile is absent or
+    //! has no samples at or above the given elevation
+    bool mayReach(int32_t longitude, int32_t latitude, int16_t elevation) const;
+
+    std::string indexFilename() const;
+
+  private:
+    typedef std::pair<int32_t,int32_t>           Key;
+    typedef std::map<Key, DTEDTileSummary>       TileMap;
+
+    std::string  fDirectory;
+    bool         fValid;
+    TileMap      fTiles;
+  };
+
+}
+
+#endif // DTEDTILEINDEX_HPP
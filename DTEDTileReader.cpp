@@ -0,0 +1,244 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file DTEDTileReader.cpp
+
+  Reader for the samples of raw, gzipped and zipped SRTM tile files
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#include <cstring>
+#include <algorithm>
+
+#include <sys/stat.h>
+
+#include "DTEDTileReader.hpp"
+
+using namespace VERITAS;
+
+namespace
+{
+  const size_t   INPUT_BUFFER      = 65536;
+
+  const uint32_t ZIP_LOCAL_HEADER  = 0x04034b50;
+  const uint16_t ZIP_STORED        = 0;
+  const uint16_t ZIP_DEFLATED      = 8;
+  const uint16_t ZIP_DESCRIPTOR    = 0x0008;  // sizes follow the data
+
+  // Zip and gzip fields are little-endian
+  inline uint16_t le16(const uint8_t* p)
+  {
+    return uint16_t(p[0]) | (uint16_t(p[1])<<8);
+  }
+
+  inline uint32_t le32(const uint8_t* p)
+  {
+    return uint32_t(p[0]) | (uint32_t(p[1])<<8) | (uint32_t(p[2])<<16) |
+      (uint32_t(p[3])<<24);
+  }
+
+  bool endsWith(const std::string& s, const std::string& suffix)
+  {
+    return (s.size() >= suffix.size()) &&
+      (s.compare(s.size()-suffix.size(), suffix.size(), suffix) == 0);
+  }
+}
+
+// ----------------------------------------------------------------------------
+// DTED Tile Reader
+// ----------------------------------------------------------------------------
+
+DTEDTileReader::DTEDTileReader():
+  fFP(), fFormat(F_RAW), fBase(), fInflating(false), fStreamEnd(false),
+  fZ(), fIn()
+{
+  // nothing to see here
+}
+
+DTEDTileReader::~DTEDTileReader()
+{
+  close();
+}
+
+DTEDTileReader::Format DTEDTileReader::formatOf(const std::string& filename)
+{
+  if(endsWith(filename, ".zip"))return F_ZIP;
+  if(endsWith(filename, ".gz"))return F_GZIP;
+  return F_RAW;
+}
+
+bool DTEDTileReader::findZipEntry(FILE* fp, uint16_t& method,
+				  uint64_t& compressed_size,
+				  uint64_t& uncompressed_size)
+{
+  // Walk the local headers to the first entry named *.hgt; others can be
+  // passed over only if their sizes are in the header
+  for(;;)
+    {
+      uint8_t h[30];
+      if((fread(h, 1, sizeof(h), fp) != sizeof(h))||
+	 (le32(h) != ZIP_LOCAL_HEADER))
+	return false;
+      const uint16_t flags = le16(h+6);
+      method               = le16(h+8);
+      compressed_size      = le32(h+18);
+      uncompressed_size    = le32(h+22);
+      const uint16_t nname = le16(h+26);
+      const uint16_t nextra = le16(h+28);
+
+      std::string name(nname, '\0');
+      if((nname && (fread(&name[0], 1, nname, fp) != nname))||
+	 (fseek(fp, nextra, SEEK_CUR) != 0))
+	return false;
+
+      std::string lower(name);
+      std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+      if(endsWith(lower, ".hgt"))
+	{
+	  if(flags & ZIP_DESCRIPTOR)uncompressed_size = 0;
+	  return true;
+	}
+
+      if((flags & ZIP_DESCRIPTOR)||
+	 (fseek(fp, long(compressed_size), SEEK_CUR) != 0))
+	return false;
+    }
+}
+
+bool DTEDTileReader::open(const std::string& filename)
+{
+  close();
+
+  fFormat = formatOf(filename);
+  fFP = fopen(filename.c_str(), "rb");
+  if(!fFP)return false;
+
+  bool inflate_stream = false;
+  int window_bits = 0;
+  if(fFormat == F_GZIP)
+    {
+      inflate_stream = true;
+      window_bits = 15+16;       // gzip wrapper
+    }
+  else if(fFormat == F_ZIP)
+    {
+      uint16_t method;
+      uint64_t compressed_size;
+      uint64_t uncompressed_size;
+      if(!findZipEntry(fFP, method, compressed_size, uncompressed_size)||
+	 ((method != ZIP_STORED)&&(method != ZIP_DEFLATED)))
+	{
+	  close();
+	  return false;
+	}
+      inflate_stream = (method == ZIP_DEFLATED);
+      window_bits = -15;         // raw deflate
+    }
+
+  fBase = ftell(fFP);
+  if(inflate_stream)
+    {
+      memset(&fZ, 0, sizeof(fZ));
+      if(inflateInit2(&fZ, window_bits) != Z_OK)
+	{
+	  close();
+	  return false;
+	}
+      fIn.resize(INPUT_BUFFER);
+      fInflating = true;
+      fStreamEnd = false;
+    }
+  return true;
+}
+
+void DTEDTileReader::close()
+{
+  if(fInflating)inflateEnd(&fZ);
+  if(fFP)fclose(fFP);
+  fFP = 0;
+  fInflating = false;
+  fStreamEnd = false;
+  fBase = 0;
+}
+
+bool DTEDTileReader::seek(uint64_t offset)
+{
+  if(!seekable())return false;
+  return fseek(fFP, fBase+long(offset), SEEK_SET) == 0;
+}
+
+bool DTEDTileReader::read(void* buffer, size_t n)
+{
+  if(!fFP)return false;
+  if(!fInflating)return fread(buffer, 1, n, fFP) == n;
+
+  fZ.next_out  = static_cast<Bytef*>(buffer);
+  fZ.avail_out = uInt(n);
+  while(fZ.avail_out)
+    {
+      if(fStreamEnd)return false;
+      if(fZ.avail_in == 0)
+	{
+	  const size_t got = fread(&fIn.front(), 1, fIn.size(), fFP);
+	  if(got == 0)return false;
+	  fZ.next_in  = &fIn.front();
+	  fZ.avail_in = uInt(got);
+	}
+      const int status = inflate(&fZ, Z_NO_FLUSH);
+      if(status == Z_STREAM_END)fStreamEnd = true;
+      else if(status != Z_OK)return false;
+    }
+  return true;
+}
+
+bool DTEDTileReader::skip(uint64_t n)
+{
+  if(!fFP)return false;
+  if(!fInflating)return fseek(fFP, long(n), SEEK_CUR) == 0;
+
+  uint8_t scratch[4096];
+  while(n)
+    {
+      const size_t m = size_t(std::min(n, uint64_t(sizeof(scratch))));
+      if(!read(scratch, m))return false;
+      n -= m;
+    }
+  return true;
+}
+
+uint64_t DTEDTileReader::dataSize(const std::string& filename)
+{
+  const Format format = formatOf(filename);
+  if(format == F_RAW)
+    {
+      struct stat st;
+      if(stat(filename.c_str(), &st) != 0)return 0;
+      return uint64_t(st.st_size);
+    }
+
+  FILE* fp = fopen(filename.c_str(), "rb");
+  if(!fp)return 0;
+  uint64_t size = 0;
+  if(format == F_GZIP)
+    {
+      // ISIZE, the length of the input modulo 2^32, ends the file
+      uint8_t trailer[4];
+      if((fseek(fp, -4, SEEK_END) == 0)&&
+	 (fread(trailer, 1, sizeof(trailer), fp) == sizeof(trailer)))
+	size = le32(trailer);
+    }
+  else
+    {
+      uint16_t method;
+      uint64_t compressed_size;
+      if(!findZipEntry(fp, method, compressed_size, size))size = 0;
+    }
+  fclose(fp);
+  return size;
+}
@@ -0,0 +1,84 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file DTEDTileReader.hpp
+
+  Reader for the samples of raw, gzipped and zipped SRTM tile files
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#ifndef DTEDTILEREADER_HPP
+#define DTEDTILEREADER_HPP
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <stdint.h>
+
+#include <zlib.h>
+
+//! VERITAS namespace
+namespace VERITAS
+{
+
+  //! Sequential reader of the sample bytes of a tile file: N34W119.hgt,
+  //! N34W119.hgt.gz, or N34W119.hgt.zip holding N34W119.hgt. Compressed
+  //! data is inflated as it is read through a small input buffer, so
+  //! neither the file nor the samples are ever held whole. Raw files,
+  //! and zip entries that are stored rather than deflated, can also be
+  //! read at random with seek().
+  class DTEDTileReader
+  {
+  public:
+    enum Format { F_RAW, F_GZIP, F_ZIP };
+
+    DTEDTileReader();
+    ~DTEDTileReader();
+
+    DTEDTileReader(const DTEDTileReader&) = delete;
+    DTEDTileReader& operator= (const DTEDTileReader&) = delete;
+
+    bool open(const std::string& filename);
+    void close();
+    bool isOpen() const { return fFP != 0; }
+
+    Format format() const { return fFormat; }
+    bool seekable() const { return fFP && !fInflating; }
+
+    //! Move to byte offset in the samples (seekable readers only)
+    bool seek(uint64_t offset);
+    //! Read the next n bytes of samples, false if there are fewer
+    bool read(void* buffer, size_t n);
+    //! Pass over the next n bytes of samples
+    bool skip(uint64_t n);
+
+    //! Format from the file name suffix
+    static Format formatOf(const std::string& filename);
+    //! Size in bytes of the samples in the file, from the file size, the
+    //! gzip trailer or the zip header without inflating; 0 if unknown
+    static uint64_t dataSize(const std::string& filename);
+
+  private:
+    //! Position fp at the data of the first .hgt entry of a zip file
+    static bool findZipEntry(FILE* fp, uint16_t& method,
+			     uint64_t& compressed_size,
+			     uint64_t& uncompressed_size);
+
+    FILE*                fFP;
+    Format               fFormat;
+    long                 fBase;       //!< file offset of the samples
+    bool                 fInflating;
+    bool                 fStreamEnd;
+    z_stream             fZ;
+    std::vector<uint8_t> fIn;
+  };
+
+}
+
+#endif // DTEDTILEREADER_HPP
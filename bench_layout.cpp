@@ -0,0 +1,297 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file bench_layout.cpp
+
+  Program to time neighbourhood kernels on maps stored in rows and in
+  Z-ordered blocks
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+
+#include <VSOptions.hpp>
+#include <DTED.hpp>
+#include <DTEDStats.hpp>
+
+using namespace VERITAS;
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now()-
+				       start).count();
+}
+
+// Region of output pixels [x0,x1) x [y0,y1) and the order to visit them:
+// along rows, or block by block so that the neighbourhoods of
+// successive pixels overlap as much as possible
+class Region
+{
+public:
+  unsigned fX0;
+  unsigned fY0;
+  unsigned fX1;
+  unsigned fY1;
+  bool     fBlocks;
+};
+
+// Visit each pixel of the region in parallel, calling kernel(x,y)
+template<typename Kernel> void visit(const Region& r, Kernel& kernel)
+{
+  if(!r.fBlocks)
+    {
+#pragma omp parallel for schedule(static)
+      for(int iy=int(r.fY0);iy<int(r.fY1);iy++)
+	for(unsigned x=r.fX0;x<r.fX1;x++)kernel(x,unsigned(iy));
+      return;
+    }
+
+  const unsigned B = DTEDMap::BLOCK_SIZE;
+  const unsigned bx0 = r.fX0/B;
+  const unsigned by0 = r.fY0/B;
+  const unsigned nbx = (r.fX1+B-1)/B-bx0;
+  const unsigned nby = (r.fY1+B-1)/B-by0;
+#pragma omp parallel for schedule(dynamic)
+  for(int ib=0;ib<int(nbx*nby);ib++)
+    {
+      const unsigned bx = bx0+unsigned(ib)%nbx;
+      const unsigned by = by0+unsigned(ib)/nbx;
+      const unsigned xa = std::max(bx*B, r.fX0);
+      const unsigned xb = std::min((bx+1)*B, r.fX1);
+      const unsigned ya = std::max(by*B, r.fY0);
+      const unsigned yb = std::min((by+1)*B, r.fY1);
+      for(unsigned y=ya;y<yb;y++)
+	for(unsigned x=xa;x<xb;x++)kernel(x,y);
+    }
+}
+
+// Range of elevations over the footprint centred on each pixel. Each
+// footprint row is taken as runs of samples that are contiguous in the
+// map: the whole span in rows, or the parts in each block
+class DiscRange
+{
+public:
+  DiscRange(const DTEDMap& map, const DTEDFootprint& footprint,
+	    std::vector<int16_t>& out):
+    fMap(map), fFootprint(footprint), fOut(out),
+    fRun((map.layout()==DTEDMap::L_ROWS) ? map.width() :
+	 unsigned(DTEDMap::BLOCK_SIZE)) { }
+  void operator() (unsigned x, unsigned y)
+  {
+    int16_t mn = 32767;
+    int16_t mx = -32768;
+    for(int iy=-fFootprint.ny();iy<=fFootprint.ny();iy++)
+      {
+	const int hw = fFootprint.halfWidth(iy);
+	const unsigned xb = x+hw+1;
+	for(unsigned xa=x-hw;xa<xb;)
+	  {
+	    const unsigned n = std::min(xb-xa, fRun-xa%fRun);
+	    const int16_t* z = &fMap(xa,y+iy);
+	    for(unsigned i=0;i<n;i++)
+	      if(z[i] != -32768)mn = std::min(mn,z[i]), mx = std::max(mx,z[i]);
+	    xa += n;
+	  }
+      }
+    fOut[y*fMap.width()+x] = (mx<mn) ? int16_t(-32768) : int16_t(mx-mn);
+  }
+private:
+  const DTEDMap&        fMap;
+  const DTEDFootprint&  fFootprint;
+  std::vector<int16_t>& fOut;
+  unsigned              fRun;
+};
+
+// Horn gradient magnitude squared on the 3x3 neighbourhood
+class Gradient
+{
+public:
+  Gradient(const DTEDMap& map, std::vector<int16_t>& out):
+    fMap(map), fOut(out) { }
+  void operator() (unsigned x, unsigned y)
+  {
+    const int32_t a = fMap(x-1,y+1), b = fMap(x,y+1), c = fMap(x+1,y+1);
+    const int32_t d = fMap(x-1,y),                    f = fMap(x+1,y);
+    const int32_t p = fMap(x-1,y-1), q = fMap(x,y-1), r = fMap(x+1,y-1);
+    const int32_t gx = (c+2*f+r)-(a+2*d+p);
+    const int32_t gy = (a+2*b+c)-(p+2*q+r);
+    fOut[y*fMap.width()+x] = int16_t(std::min(gx*gx+gy*gy, 32767));
+  }
+private:
+  const DTEDMap&        fMap;
+  std::vector<int16_t>& fOut;
+};
+
+static uint64_t checksum(const std::vector<int16_t>& v)
+{
+  uint64_t sum = 0;
+  for(unsigned i=0;i<v.size();i++)sum = sum*31 + uint16_t(v[i]);
+  return sum;
+}
+
+int main(int argc, char** argv)
+{
+  VSOptions options(argc,argv);
+
+  double radius = 720;              // M
+  unsigned size = 3601;             // Synthetic map size
+  unsigned repeat = 3;
+  options.findWithValue("radius", radius);
+  options.findWithValue("size", size);
+  options.findWithValue("repeat", repeat);
+
+  const double wgs84_a = 6378136.49; // m
+  const double wgs84_b = 6356751.7;
+  const double wgs84_r = (wgs84_a+wgs84_b)/2.0;
+
+  char* progname = *argv;
+  argv++, argc--;
+
+  if((argc > 1)||(repeat == 0))
+    {
+      std::cerr << "Usage: " << progname
+		<< " [-radius=m] [-size=n] [-repeat=n] [tile.hgt]"
+		<< std::endl;
+      exit(EXIT_FAILURE);
+    }
+
+  // --------------------------------------------------------------------------
+  // Map in rows, from an SRTM tile or synthetic, and its blocked copy
+  // --------------------------------------------------------------------------
+
+  DTEDMapPtr rows;
+  if(argc)
+    {
+      rows = DTEDMap::loadSRTMTile(*argv);
+      if(!rows)exit(EXIT_FAILURE);
+    }
+  else
+    {
+      rows.reset(new DTEDMap(size, size, 0, 0));
+      srand(1);
+      for(unsigned y=0;y<size;y++)
+	for(unsigned x=0;x<size;x++)
+	  (*rows)(x,y) = int16_t(2000 + 500*sin(double(x)*0.01)*
+				 cos(double(y)*0.013) + rand()%16);
+    }
+
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+  DTEDMapPtr blocks = rows->convert(DTEDMap::L_BLOCKS);
+  const double t_to_blocks = seconds(start);
+  start = std::chrono::steady_clock::now();
+  DTEDMapPtr back = blocks->convert(DTEDMap::L_ROWS);
+  const double t_to_rows = seconds(start);
+  if(!std::equal(rows->data(), rows->data()+rows->size(), back->data()))
+    {
+      std::cerr << "Conversion round trip failed" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  back.reset();
+
+  std::cout << "Map:          " << rows->width() << " x " << rows->height()
+	    << std::endl
+	    << "To blocks:    " << t_to_blocks << " s" << std::endl
+	    << "To rows:      " << t_to_rows << " s" << std::endl;
+
+  double lat = (double(rows->bottom())+0.5*double(rows->height()))/
+    double(rows->resolution());
+  double scale_y = wgs84_r*M_PI/180.0/double(rows->resolution());
+  double scale_x = scale_y*cos(lat/180.0*M_PI);
+  DTEDFootprint footprint(radius, scale_x, scale_y);
+
+  Region region;
+  region.fX0 = footprint.nx()+1;
+  region.fY0 = footprint.ny()+1;
+  region.fX1 = rows->width()-footprint.nx()-1;
+  region.fY1 = rows->height()-footprint.ny()-1;
+  if((region.fX1 <= region.fX0)||(region.fY1 <= region.fY0))
+    {
+      std::cerr << "Map is smaller than the footprint" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+
+  // --------------------------------------------------------------------------
+  // Each kernel on each layout, visiting pixels in rows and in blocks;
+  // the outputs must agree whatever the layout and order
+  // --------------------------------------------------------------------------
+
+  const char* layout_name[] = { "rows", "blocks" };
+  const DTEDMap* map[] = { rows.get(), blocks.get() };
+  const size_t npix = rows->width()*rows->height();
+
+  std::cout << std::endl
+	    << "Kernel       Layout  Order      Time [s]   Checksum"
+	    << std::endl;
+  bool mismatch = false;
+  uint64_t reference = 0;
+  for(unsigned ikernel=0;ikernel<2;ikernel++)
+    for(unsigned ilayout=0;ilayout<2;ilayout++)
+      for(unsigned iorder=0;iorder<2;iorder++)
+	{
+	  region.fBlocks = (iorder==1);
+	  std::vector<int16_t> out(npix, int16_t(-32768));
+	  double best = 0;
+	  for(unsigned irepeat=0;irepeat<repeat;irepeat++)
+	    {
+	      start = std::chrono::steady_clock::now();
+	      if(ikernel == 0)
+		{
+		  DiscRange kernel(*map[ilayout], footprint, out);
+		  visit(region, kernel);
+		}
+	      else
+		{
+		  Gradient kernel(*map[ilayout], out);
+		  visit(region, kernel);
+		}
+	      const double t = seconds(start);
+	      if((irepeat==0)||(t<best))best = t;
+	    }
+	  // Compare with the kernel's output on rows, visited in rows
+	  const uint64_t sum = checksum(out);
+	  if((ilayout==0)&&(iorder==0))reference = sum;
+	  const bool same = (sum == reference);
+	  if(!same)mismatch = true;
+	  std::cout << (ikernel==0 ? "disc range " : "gradient   ") << "  "
+		    << layout_name[ilayout]
+		    << std::string(8-strlen(layout_name[ilayout]),' ')
+		    << layout_name[iorder]
+		    << std::string(11-strlen(layout_name[iorder]),' ')
+		    << best << "   " << std::hex << sum << std::dec
+		    << (same ? "" : "   MISMATCH") << std::endl;
+	}
+
+  if(mismatch)
+    {
+      std::cerr << "Outputs differ between layouts or orders" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+
+  // For comparison, the fused row-streaming kernel used by find_flat
+  DTEDTerrainStats stats;
+  double best = 0;
+  for(unsigned irepeat=0;irepeat<repeat;irepeat++)
+    {
+      start = std::chrono::steady_clock::now();
+      stats.compute(*rows, footprint, region.fX0, region.fY0,
+		    region.fX1, region.fY1, DTEDTerrainStats::S_RANGE);
+      const double t = seconds(start);
+      if((irepeat==0)||(t<best))best = t;
+    }
+  std::cout << "disc range   rows    stream     " << best << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,141 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file contour.cpp
+
+  Program to extract elevation contours around a point from SRTM tiles
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include <cmath>
+
+#include <DTED.hpp>
+#include <DTEDContour.hpp>
+#include <DTEDTileIndex.hpp>
+
+using namespace VERITAS;
+
+int main(int argc, char** argv)
+{
+  const uint32_t TILERES = 1200;
+
+  const double wgs84_a = 6378136.49; // m
+  const double wgs84_b = 6356751.7;
+  const double wgs84_r = (wgs84_a+wgs84_b)/2.0;
+
+  std::string directory;
+
+  double lat_zero = 34.05;          // Degrees (default is centered on LA)
+  double long_zero = -118.25;       // Degrees (default is centered on LA)
+  double radius = 10;               // KM
+  std::string intervals_list = "10,100"; // M
+  std::string format = "geojson";
+
+  char* progname = *argv;
+  argv++, argc--;
+
+  if(argc == 0)
+    {
+      std::cerr << "Usage: " << progname
+		<< " directory [long] [lat] [radius] [intervals] [geojson|binary]"
+		<< std::endl;
+      exit(EXIT_FAILURE);
+    }
+
+  directory = std::string(*argv);
+  argv++, argc--;
+
+  if(argc)
+    {
+      std::istringstream stream(*argv);
+      stream >> long_zero;
+      argv++, argc--;
+    }
+
+  if(argc)
+    {
+      std::istringstream stream(*argv);
+      stream >> lat_zero;
+      argv++, argc--;
+    }
+
+  if(argc)
+    {
+      std::istringstream stream(*argv);
+      stream >> radius;
+      argv++, argc--;
+    }
+
+  if(argc)
+    {
+      intervals_list = std::string(*argv);
+      argv++, argc--;
+    }
+
+  if(argc)
+    {
+      format = std::string(*argv);
+      argv++, argc--;
+    }
+
+  if((format != "geojson")&&(format != "binary"))
+    {
+      std::cerr << "Unknown format: " << format << std::endl;
+      exit(EXIT_FAILURE);
+    }
+
+  radius *= 1000;
+
+  double v_extent = radius/wgs84_r/M_PI*180.0;
+  double h_extent = v_extent/cos(lat_zero/180.0*M_PI);
+
+  int32_t bound_l = int32_t(floor((long_zero - h_extent)*double(TILERES)));
+  int32_t bound_r = int32_t(ceil((long_zero + h_extent)*double(TILERES)));
+  int32_t bound_b = int32_t(floor((lat_zero - v_extent)*double(TILERES)));
+  int32_t bound_t = int32_t(ceil((lat_zero + v_extent)*double(TILERES)));
+
+  std::cerr << "Boundary: "
+	    << bound_l << ',' << bound_b << " -> "
+	    << bound_r << ',' << bound_t << std::endl;
+
+  DTEDTileIndex index(directory);
+  index.load();
+
+  DTEDMapPtr map =
+    DTEDMap::loadSRTMRegionFromDir(directory,
+				   bound_r-bound_l+1, bound_t-bound_b+1,
+				   bound_l, bound_b, TILERES, &index);
+
+  // Each line carries the largest interval its level is a multiple of,
+  // so major and minor contours can be drawn differently
+  std::vector<double> intervals;
+  std::istringstream interval_stream(intervals_list);
+  std::string interval_string;
+  while(std::getline(interval_stream, interval_string, ','))
+    {
+      double interval = 0;
+      std::istringstream stream(interval_string);
+      stream >> interval;
+      intervals.push_back(interval);
+    }
+
+  DTEDContours contours;
+  contours.extractIntervals(*map, intervals);
+  map.reset();
+
+  std::cerr << "Contours: " << contours.lines().size() << std::endl;
+
+  if(format == "binary")contours.writeBinary(std::cout);
+  else contours.writeGeoJSON(std::cout);
+
+  return EXIT_SUCCESS;
+}
@@ -27,18 +27,39 @@ colormap(ccc)
 
 caxis([cce(1) cce(length(cce))])
 
-cl1=0:10:4000;
-cl1=cl1(mod(cl1,100) ~= 0);
-hold on; 
-[c1,h1]=contour(x(xma),y(yma),asm,cl1,'k'); 
-set(h1,'LineWidth',0.2);
-
-cl2=0:100:4000;
-hold on; 
-[c2,h2]=contour(x(xma),y(yma),asm,cl2,'k'); 
-set(h2,'LineWidth',1.0);
-
-clabel(c2,h2,'fontsize',6)
+% Contours from the contour program, e.g.
+%   contour srtm -118.25 34.05 5 10,100 binary > /tmp/contour.bin
+lon0=-118.25;
+lat0=34.05;
+R=(6378136.49+6356751.7)/2/1000;
+
+fid=fopen('/tmp/contour.bin','r');
+magic=fread(fid,8,'*char')';
+if ~strcmp(magic,'DTEDCON2'), error('not a contour file'); end
+left=fread(fid,1,'int32');
+bottom=fread(fid,1,'int32');
+res=fread(fid,1,'uint32');
+nline=fread(fid,1,'uint32');
+hold on;
+for l=1:nline
+  level=fread(fid,1,'float32');
+  interval=fread(fid,1,'float32');
+  closed=fread(fid,1,'uint32');
+  npoint=fread(fid,1,'uint32');
+  xy=fread(fid,[2 npoint],'float32');
+  lon=(left+xy(1,:))/res;
+  lat=(bottom+xy(2,:))/res;
+  cx=R*cos(lat0/180*pi)*(lon-lon0)/180*pi;
+  cy=R*(lat-lat0)/180*pi;
+  if interval >= 100
+    set(line(cx,cy),'LineWidth',1.0,'Color','k');
+    text(cx(1),cy(1),num2str(level),'fontsize',6);
+  else
+    set(line(cx,cy),'LineWidth',0.2,'Color','k');
+  end
+end
+fclose(fid);
+axis([-3 3 -3 3]);
 
 i=0:360;
 XX=-2.5+0.1*cos(i/180*pi);
@@ -17,18 +17,198 @@
 #include <sstream>
 #include <vector>
 #include <cmath>
+#include <algorithm>
+#include <set>
 
+#include <VSOptions.hpp>
 #include <DTED.hpp>
+#include <DTEDAllocator.hpp>
+#include <DTEDParallel.hpp>
+#include <DTEDStats.hpp>
+#include <DTEDTileIndex.hpp>
+#include <DTEDRegions.hpp>
+#include <DTEDResultStore.hpp>
 
 using namespace VERITAS;
 
+static std::vector<double> parseList(const std::string& list)
+{
+  std::vector<double> values;
+  std::istringstream stream(list);
+  std::string value_string;
+  while(std::getline(stream, value_string, ','))
+    {
+      double value = 0;
+      std::istringstream value_stream(value_string);
+      if(value_stream >> value)values.push_back(value);
+    }
+  return values;
+}
+
+//! Footprint pixel scales [m] at the centre of the tiles in row tile_y
+static void tileScales(double earth_radius, int32_t tile_y, int32_t res,
+		       double& scale_x, double& scale_y)
+{
+  const double latitude = (double(tile_y)+0.5)/180.0*M_PI;
+  scale_y = earth_radius*M_PI/180.0/double(res);
+  scale_x = scale_y*cos(latitude);
+}
+
+typedef std::pair<int32_t,int32_t> TilePosition;
+
+//! Whether the tile at (x,y) is processed in this run: it was named on
+//! the command line and a copy of it can be found
+static bool processed(const std::set<TilePosition>& run,
+		      const std::string& dir, const DTEDTileIndex* index,
+		      int32_t x, int32_t y)
+{
+  x = DTEDMap::round(x,1);
+  if((y<-90)||(y>89)||(run.find(TilePosition(x,y)) == run.end()))
+    return false;
+  return !DTEDMap::findSRTMTile(dir,x,y,index).empty();
+}
+
+//! One combination of flatness criteria and what it selected
+class FlatCut
+{
+public:
+  FlatCut(double radius, int16_t floor, int16_t range,
+	  double earth_radius, bool outline):
+    fRadius(radius), fFloor(floor), fRange(range), fPixels(), fArea(),
+    fLabeller(earth_radius, outline) { }
+  double             fRadius;
+  int16_t            fFloor;
+  int16_t            fRange;
+  uint64_t           fPixels;
+  double             fArea;
+  DTEDRegionLabeller fLabeller;
+};
+
 int main(int argc, char** argv)
 {
+  VSOptions options(argc,argv);
+
+  // --------------------------------------------------------------------------
+  // Output one record per connected flat region rather than per pixel
+  // --------------------------------------------------------------------------
+
+  bool regions = false;
+  if(options.find("regions") != VSOptions::FS_NOT_FOUND)regions=true;
+  bool outline = false;
+  if(options.find("outline") != VSOptions::FS_NOT_FOUND)outline=true;
+
+  // --------------------------------------------------------------------------
+  // Flatness criteria. With -sweep each may be a comma separated list, the
+  // footprint statistics are computed once per radius and every
+  // combination is evaluated on them, giving one summary line each. Each
+  // pixel belongs to one tile only, so the pixel, area and region totals
+  // count the samples tiles share once.
+  // --------------------------------------------------------------------------
+
+  bool sweep = false;
+  if(options.find("sweep") != VSOptions::FS_NOT_FOUND)sweep=true;
+
+  // --------------------------------------------------------------------------
+  // Every tile and 3x3 mosaic has the same size, so recycle their buffers
+  // through a pool rather than mapping and faulting in fresh memory each
+  // time. Huge pages reduce TLB misses on the footprint scans.
+  // --------------------------------------------------------------------------
+
+  bool huge_pages = true;
+  if(options.find("no_huge_pages") != VSOptions::FS_NOT_FOUND)huge_pages=false;
+  bool alloc_stats = false;
+  if(options.find("alloc_stats") != VSOptions::FS_NOT_FOUND)alloc_stats=true;
+
+  DTEDPoolAllocator pool(huge_pages);
+  DTEDAllocator::setDefault(&pool);
+
+  // --------------------------------------------------------------------------
+  // With -pin_threads each thread stays on one CPU, so the row bands of
+  // the mosaics it fills remain on its NUMA node for the kernels
+  // --------------------------------------------------------------------------
+
+  if(options.find("pin_threads") != VSOptions::FS_NOT_FOUND)
+    dtedPinThreads(&std::cerr);
+
+  std::string radius_list = "720";  // Nine rings * 80m seperation
+  std::string floor_list = "2500";  // Minimum elevation [m]
+  std::string range_list = "100";   // Maximum el_max - el_min [m]
+  unsigned max_voids = 10;
+  double percentile = 0;            // Range from p to 100-p percentile
+  options.findWithValue("radius", radius_list);
+  options.findWithValue("floor", floor_list);
+  options.findWithValue("range", range_list);
+  options.findWithValue("max_voids", max_voids);
+  options.findWithValue("percentile", percentile);
+
+  // --------------------------------------------------------------------------
+  // With -percentile=p the floor and range cuts apply to the p-th and
+  // (100-p)-th percentile elevations of the footprint rather than its
+  // minimum and maximum, so a spike or radar artefact does not reject it
+  // --------------------------------------------------------------------------
+
+  if((percentile < 0)||(percentile >= 50))
+    {
+      std::cerr << "Percentile must be in the range [0,50)" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  const bool robust = percentile > 0;
+
+  std::vector<double> radii  = parseList(radius_list);
+  std::vector<double> floors = parseList(floor_list);
+  std::vector<double> ranges = parseList(range_list);
+
+  if(radii.empty()||floors.empty()||ranges.empty())
+    {
+      std::cerr << "Empty radius, floor or range list" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+
+  if(!sweep)
+    {
+      radii.resize(1);
+      floors.resize(1);
+      ranges.resize(1);
+    }
+
   const double wgs84_a = 6378136.49; // m
   const double wgs84_b = 6356751.7;
   const double wgs84_r = (wgs84_a+wgs84_b)/2.0;
+  const int32_t res = 1200;         // SRTM3 tile resolution
+
+  std::vector<FlatCut> cuts;
+  for(unsigned ir=0;ir<radii.size();ir++)
+    for(unsigned jf=0;jf<floors.size();jf++)
+      for(unsigned kr=0;kr<ranges.size();kr++)
+	cuts.push_back(FlatCut(radii[ir], int16_t(floors[jf]),
+			       int16_t(ranges[kr]), wgs84_r, outline));
 
-  const double search_radius = 9*80; // Nine rings * 80m seperation
+  const unsigned stats_flags = (sweep ?
+    (DTEDTerrainStats::S_RANGE|DTEDTerrainStats::S_MEAN) :
+    DTEDTerrainStats::S_ALL) | (robust ? DTEDTerrainStats::S_PERCENTILE : 0);
+
+  // --------------------------------------------------------------------------
+  // With -store=dir the selected pixels of each tile are kept in dir and
+  // reused on later runs unless the tile, a neighbour or the criteria
+  // have changed. The tile index is brought up to date to get checksums.
+  // --------------------------------------------------------------------------
+
+  std::string store_dir;
+  options.findWithValue("store", store_dir);
+  DTEDResultStore* store = 0;
+  if(!store_dir.empty())store = new DTEDResultStore(store_dir);
+
+  std::ostringstream parameter_stream;
+  parameter_stream << "flags=" << stats_flags << " max_voids=" << max_voids
+		   << " earth_radius=" << wgs84_r << " extent=" << res;
+  if(robust)parameter_stream << " percentile=" << percentile;
+  for(unsigned icut=0;icut<cuts.size();icut++)
+    parameter_stream << " cut=" << cuts[icut].fRadius << ','
+		     << cuts[icut].fFloor << ',' << cuts[icut].fRange;
+  const std::string parameters = parameter_stream.str();
+
+  const int16_t min_elevation = 
+    int16_t(*std::min_element(floors.begin(), floors.end()));
 
   const int32_t x_off[] = { 1, 1, 0, -1, -1, -1 , 0, 1 };
   const int32_t y_off[] = { 0, 1, 1, 1, 0, -1 , -1, -1 };
@@ -36,126 +216,304 @@ int main(int argc, char** argv)
   char* program = *argv;
   argv++, argc--;
 
+  if(argc == 0)
+    {
+      std::cerr << "Usage: " << program 
+		<< " [-regions [-outline]] [-sweep] [-radius=r1,r2...]"
+		<< " [-floor=f1,f2...] [-range=d1,d2...] [-max_voids=n]"
+		<< " [-percentile=p]"
+		<< " [-no_huge_pages] [-alloc_stats] [-pin_threads] [-store=dir]"
+		<< " filenames" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+
+  std::set<TilePosition> run;
+  for(int i=0;i<argc;i++)
+    {
+      int32_t x = 0;
+      int32_t y = 0;
+      if(DTEDMap::parseSRTMTileName(argv[i], x, y))
+	run.insert(TilePosition(DTEDMap::round(x,1),y));
+    }
+
+  // --------------------------------------------------------------------------
+  // Each footprint must fit in the 3x3 mosaic, within the neighbouring
+  // tiles. Footprints are widest in the tiles furthest from the equator.
+  // --------------------------------------------------------------------------
+
+  int32_t widest_y = 0;
+  for(std::set<TilePosition>::const_iterator i=run.begin();i!=run.end();i++)
+    if(fabs(double(i->second)+0.5) > fabs(double(widest_y)+0.5))
+      widest_y = i->second;
+
+  double widest_scale_x;
+  double widest_scale_y;
+  tileScales(wgs84_r, widest_y, res, widest_scale_x, widest_scale_y);
+  for(unsigned ir=0;ir<radii.size();ir++)
+    {
+      if(radii[ir] < 0)
+	{
+	  std::cerr << "Radius must not be negative" << std::endl;
+	  exit(EXIT_FAILURE);
+	}
+      DTEDFootprint footprint(radii[ir], widest_scale_x, widest_scale_y);
+      if((footprint.nx()+1 > res)||(footprint.ny()+1 > res))
+	{
+	  std::cerr << "Radius " << radii[ir] << " is too large: at latitude "
+		    << widest_y << " its footprint reaches beyond the "
+		    << "neighbouring tiles" << std::endl;
+	  exit(EXIT_FAILURE);
+	}
+    }
+
+  DTEDTileIndex* index = 0;
+
   while(argc)
     {
       std::string filename(*argv);
-      DTEDMap* tile = DTEDMap::loadSRTMTile(filename);
 
-      if(tile)
+      std::string dir;
+      if(filename.rfind("/") != std::string::npos)
+	dir = filename.substr(0,filename.rfind("/"));
+
+      if((index == 0)||(index->directory() != dir))
 	{
+	  delete index;
+	  index = new DTEDTileIndex(dir);
+	  index->load();
+	  if(store && index->update())index->save();
+	}
+
+      // Skip tiles that the index says cannot pass the elevation cut
+      // before doing any I/O on them
+      int32_t tile_x = 0;
+      int32_t tile_y = 0;
+      if(DTEDMap::parseSRTMTileName(filename, tile_x, tile_y) &&
+	 !index->mayReach(tile_x, tile_y, min_elevation))
+	{
+	  std::cerr << "Skipped " << filename << std::endl;
+	  argv++, argc--;
+	  continue;
+	}
+
+      // Tiles share their last row and column with their neighbours. Each
+      // shared sample is processed by the first of the tiles holding it,
+      // in the order: the tile whose res x res block it falls in, the one
+      // to its west, to its south, to its south-west, that is processed
+      // in this run. So a tile always processes its own res x res samples,
+      // its top row or right column only when the tile to the north or
+      // east is not processed, and the top-left or top-right corner only
+      // when the north-west or north-east tile is not processed either.
+      // Every pixel is then output, counted and labelled once, and none is
+      // lost at the edge of the run.
+
+      const bool own_right = !processed(run, dir, index, tile_x+1, tile_y);
+      const bool own_top = !processed(run, dir, index, tile_x, tile_y+1);
+      const bool own_top_left =
+	!processed(run, dir, index, tile_x-1, tile_y+1);
+      const bool own_top_right =
+	!processed(run, dir, index, tile_x+1, tile_y+1);
+
+      // With a result store, reuse the tile's results if neither it nor
+      // any neighbour within reach of its footprints has changed
+      std::vector<DTEDTileResult> results;
+      std::string key;
+      bool reused = false;
+      if(store)
+	{
+	  std::ostringstream edges;
+	  edges << " edges=" << own_right << own_top << own_top_left
+		<< own_top_right;
+	  key = DTEDResultStore::key(*index, tile_x, tile_y,
+				     parameters + edges.str());
+	  reused = !key.empty() && store->load(tile_x, tile_y, key, results)
+	    && (results.size() == cuts.size());
+	  if(reused)std::cerr << "Reused " << filename << std::endl;
+	}
+
+      if(!reused)
+	{
+	  // Build the 3x3 mosaic around the tile by reading each tile
+	  // straight into place, the neighbours after the tile itself so
+	  // that they win on shared edges as before
+	  DTEDMap map(3*res+1,3*res+1,(tile_x-1)*res,(tile_y-1)*res,res);
+
+	  std::vector<std::string> tiles(1, filename);
+	  for(unsigned i=0;i<8;i++)
+	    {
+	      int32_t x = DTEDMap::round(tile_x+x_off[i],1);
+	      int32_t y = tile_y+y_off[i];
+	      if((y<-90)||(y>89))continue;
+	      std::string neighbour = DTEDMap::findSRTMTile(dir,x,y,index);
+	      if(!neighbour.empty())tiles.push_back(neighbour);
+	    }
+
+	  std::vector<bool> loaded;
+	  map.mergeSRTMTiles(tiles, &loaded);
+	  if(!loaded[0])
+	    {
+	      argv++, argc--;
+	      continue;
+	    }
+
 	  std::cerr << std::endl
 		    << "-----------------------------------------------------------------------------" <<std::endl
 		    << "Loaded " << filename << std::endl
 		    << std::endl;
 
-	  int32_t l = tile->left();
-	  int32_t r = tile->right();
-	  int32_t t = tile->top();
-	  int32_t b = tile->bottom();
-
-#if 0
-	  std::cerr << "l: " << l << std::endl;
-	  std::cerr << "r: " << r << std::endl;
-	  std::cerr << "b: " << b << std::endl;
-	  std::cerr << "t: " << t << std::endl;
-	  
-	  std::cerr << "3*tile->resolution()+1: " 
-		    << 3*tile->resolution()+1 << std::endl;
-#endif
-
-	  DTEDMap map(3*tile->resolution()+1,3*tile->resolution()+1,
-		      l-tile->resolution(),b-tile->resolution(),
-		      tile->resolution());
-
-	  map.merge(*tile);
-	  delete tile;
-	  
-	  char* last_slash = 0;
-	  for(char* find = *argv; *find; find++)if(*find=='/')last_slash=find;
-	  
-	  std::string dir;
-	  if(last_slash != 0) { *last_slash = '\0'; dir = std::string(*argv); }
+	  int32_t l = DTEDMap::round(tile_x*res,res);
+	  int32_t r = l+res+(own_right?1:0);
+	  int32_t b = tile_y*res;
+	  int32_t t = b+res+(own_top?1:0);
 
-	  for(unsigned i=0;i<8;i++)
+	  for(unsigned i=1;i<tiles.size();i++)
+	    std::cerr << tiles[i] << (loaded[i] ? " loaded" : "") << std::endl;
+
+	  double scale_x;
+	  double scale_y;
+	  tileScales(wgs84_r, tile_y, res, scale_x, scale_y);
+
+	  int32_t x0 = map.xOf(l);
+	  int32_t y0 = map.yOf(b);
+	  int32_t x1 = map.xOf(r);
+	  int32_t y1 = map.yOf(t);
+
+	  DTEDTerrainStats stats;
+	  results.resize(cuts.size());
+	  for(unsigned icut=0; icut<cuts.size(); icut++)
 	    {
-	      int32_t x = DTEDMap::round(l/map.resolution()+x_off[i],1);
-	      int32_t y = DTEDMap::round(b/map.resolution()+y_off[i],1);
-	      std::cerr << "x: " << x << " y: " << y << ' ';
-	      tile = DTEDMap::loadSRTMTileFromDir(dir,x,y);
-	      if(tile)
+	      const FlatCut& cut = cuts[icut];
+	      if((icut==0)||(cut.fRadius!=cuts[icut-1].fRadius))
 		{
-		  std::cerr << "loaded";
-		  map.merge(*tile);
-		  delete tile;
+		  DTEDFootprint footprint(cut.fRadius, scale_x, scale_y);
+		  if(!stats.compute(map, footprint, x0, y0, x1, y1,
+				    stats_flags, percentile, 100.0-percentile))
+		    exit(EXIT_FAILURE);
 		}
-	      std::cerr << std::endl;
-	    }
 
-	  double mean_latitude = 
-	    double(t+b)/2.0/double(map.resolution())/180.0*M_PI;
-	  
-	  std::vector<int> dx;
-	  std::vector<int> dy;
+	      DTEDTileResult& result = results[icut];
+	      result.reset(stats);
+	      unsigned n = stats.footprintSize();
+	      for(unsigned y=0; y<stats.height(); y++)
+		{
+		  double pixel_area = scale_y*scale_y*
+		    cos(double(stats.bottom()+int32_t(y))/
+			double(map.resolution())/180.0*M_PI);
+		  for(unsigned x=0; x<stats.width(); x++)
+		    {
+		      if((y==unsigned(res))&&
+			 (((x==0)&&!own_top_left)||
+			  ((x==unsigned(res))&&!own_top_right)))continue;
 
-	  double scale_y = wgs84_r*M_PI/180.0/map.resolution();
-	  double scale_x = scale_y*cos(mean_latitude);
+		      unsigned k = stats.index(x,y);
+		      int16_t el_min = robust ? stats.fPctLow[k] : stats.fMin[k];
+		      int16_t el_max = robust ? stats.fPctHigh[k] : stats.fMax[k];
+		      unsigned el_cnt = stats.fCount[k];
 
-	  int ny = int(ceil(search_radius/scale_y))+1;
-	  int nx = int(ceil(search_radius/scale_x))+1;
-	  for(int iy=-ny;iy<=ny;iy++)
-	    {
-	      double delta_y = double(iy)*scale_y;
-	      for(int ix=-nx;ix<=nx;ix++)
-		{ 
-		  double delta_x = double(ix)*scale_x;
-		  double delta_r=sqrt(delta_x*delta_x+delta_y*delta_y);
-		  if(delta_r<=search_radius)
-		    {
-		      //std::cout << ix << ' ' << iy << std::endl;
-		      dx.push_back(ix);
-		      dy.push_back(iy);
+		      if((el_min>=cut.fFloor)&&
+			 ((el_max-el_min)<=cut.fRange)&&(n-el_cnt<max_voids))
+			result.select(stats, k, pixel_area);
 		    }
 		}
 	    }
 
-	  int32_t x0 = map.xOf(l);
-	  int32_t y0 = map.yOf(b);
-	  int32_t x1 = map.xOf(r);
-	  int32_t y1 = map.yOf(t);
+	  if(store && !key.empty())store->save(tile_x, tile_y, key, results);
+	}
+
+      // Accumulate the tile's results, whether computed or reused
+      DTEDTerrainStats stats;
+      std::vector<uint8_t> select;
+      for(unsigned icut=0; icut<cuts.size(); icut++)
+	{
+	  FlatCut& cut = cuts[icut];
+	  const DTEDTileResult& result = results[icut];
+	  cut.fPixels += result.fPixels;
+	  cut.fArea += result.fArea;
 
-	  unsigned n = dx.size();
-	  for(int32_t y=y0; y<y1; y++)
-	    for(int32_t x=x0; x<x1; x++)
+	  if(!sweep && !regions)
+	    for(unsigned i=0; i<result.fIndex.size(); i++)
 	      {
-		int16_t el_min = -32768;
-		int16_t el_max = -32768;
-		int32_t el_sum = 0;
-		unsigned el_cnt = 0;
-
-		for(unsigned i=0;i<n;i++)
-		  {
-		    int16_t el = map.datum(x+dx[i],y+dy[i]);
-		    if(el != -32768)
-		      {
-			if((el_min==-32768)||(el<el_min))el_min=el;
-			if((el_max==-32768)||(el>el_max))el_max=el;
-			el_sum+=el;
-			el_cnt++;
-		      }
-		  }
-
-		if((el_min>=2500)&&((el_max-el_min)<=100)&&
-		   (n-el_cnt<10))
-		  std::cout << map.xCoordOf(x) << ' ' 
-			    << map.yCoordOf(y) << ' '
-			    << el_min << ' '
-			    << el_max << ' '
-			    << n << ' '
-			    << el_cnt << ' '
-			    << double(el_sum)/double(el_cnt) << std::endl;
+		unsigned x = result.fIndex[i] % result.fWidth;
+		unsigned y = result.fIndex[i] / result.fWidth;
+		std::cout << DTEDMap::round(result.fLeft+int32_t(x),
+					    result.fResolution) << ' '
+			  << result.fBottom+int32_t(y) << ' '
+			  << result.fMin[i] << ' '
+			  << result.fMax[i] << ' '
+			  << result.fFootprintSize << ' '
+			  << result.fCount[i] << ' '
+			  << result.fMean[i] << ' '
+			  << result.fStdDev[i] << ' '
+			  << result.fMaxSlope[i] << ' '
+			  << result.fResidual[i];
+		if(robust)
+		  std::cout << ' ' << result.fPctLow[i]
+			    << ' ' << result.fPctHigh[i];
+		std::cout << std::endl;
 	      }
+
+	  if(regions)
+	    {
+	      result.restore(stats, select);
+	      cut.fLabeller.add(stats, select);
+	    }
 	}
 
       argv++, argc--;
     }
+
+  delete index;
+  delete store;
+
+  if(sweep)
+    {
+      for(unsigned icut=0; icut<cuts.size(); icut++)
+	{
+	  const FlatCut& cut = cuts[icut];
+	  std::cout << cut.fRadius << ' '
+		    << cut.fFloor << ' '
+		    << cut.fRange << ' '
+		    << cut.fPixels << ' '
+		    << cut.fArea/1e6;
+	  if(regions)
+	    {
+	      std::vector<DTEDRegion> found;
+	      cut.fLabeller.regions(found);
+	      std::cout << ' ' << found.size();
+	    }
+	  std::cout << std::endl;
+	}
+    }
+  else if(regions)
+    {
+      std::vector<DTEDRegion> found;
+      cuts.front().fLabeller.regions(found);
+      for(unsigned i=0;i<found.size();i++)
+	{
+	  const DTEDRegion& region = found[i];
+	  std::cout << i << ' '
+		    << region.fPixels << ' '
+		    << region.fArea/1e6 << ' '
+		    << region.centroidX() << ' '
+		    << region.centroidY() << ' '
+		    << region.fXMin << ' '
+		    << region.fYMin << ' '
+		    << region.fXMax << ' '
+		    << region.fYMax << ' '
+		    << region.fElMin << ' '
+		    << region.fElMax << ' '
+		    << region.meanElevation();
+	  if(outline)
+	    {
+	      std::cout << ' ' << region.fOutline.size();
+	      for(unsigned j=0;j<region.fOutline.size();j++)
+		std::cout << ' ' << region.fOutline[j].first
+			  << ' ' << region.fOutline[j].second;
+	    }
+	  std::cout << std::endl;
+	}
+    }
+
+  if(alloc_stats)pool.stats().print(std::cerr);
+  DTEDAllocator::setDefault(0);
 }
@@ -0,0 +1,175 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file horizon.cpp
+
+  Program to calculate the horizon profile and sky obstruction at a list
+  of candidate sites
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include <VSOptions.hpp>
+#include <DTED.hpp>
+#include <DTEDTileIndex.hpp>
+#include <DTEDHorizon.hpp>
+
+using namespace VERITAS;
+
+class Site
+{
+public:
+  unsigned fIndex;
+  int32_t  fX;      // pixel coordinates
+  int32_t  fY;
+  int32_t  fTileX;  // degrees
+  int32_t  fTileY;
+  bool operator< (const Site& o) const
+  {
+    return (fTileY<o.fTileY)||((fTileY==o.fTileY)&&(fTileX<o.fTileX))||
+      ((fTileY==o.fTileY)&&(fTileX==o.fTileX)&&(fIndex<o.fIndex));
+  }
+};
+
+int main(int argc, char** argv)
+{
+  VSOptions options(argc,argv);
+
+  // --------------------------------------------------------------------------
+  // Sites are read from stdin as "longitude latitude" in degrees, or with
+  // -pixels as the pixel coordinates in the first columns of find_flat
+  // --------------------------------------------------------------------------
+
+  bool pixels = false;
+  if(options.find("pixels") != VSOptions::FS_NOT_FOUND)pixels=true;
+  bool viewshed = false;
+  if(options.find("viewshed") != VSOptions::FS_NOT_FOUND)viewshed=true;
+
+  double observer_height = 10.0;    // M
+  double refraction = 0.13;
+  options.findWithValue("height", observer_height);
+  options.findWithValue("refraction", refraction);
+
+  const uint32_t TILERES = 1200;
+
+  const double wgs84_a = 6378136.49; // m
+  const double wgs84_b = 6356751.7;
+  const double wgs84_r = (wgs84_a+wgs84_b)/2.0;
+
+  double distance = 50;             // KM
+  unsigned nazimuth = 360;
+
+  char* progname = *argv;
+  argv++, argc--;
+
+  if(argc == 0)
+    {
+      std::cerr << "Usage: " << progname
+		<< " [-pixels] [-viewshed] [-height=m] [-refraction=k]"
+		<< " directory [distance] [nazimuth] < sites" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+
+  std::string directory(*argv);
+  argv++, argc--;
+
+  if(argc)
+    {
+      std::istringstream stream(*argv);
+      stream >> distance;
+      argv++, argc--;
+    }
+
+  if(argc)
+    {
+      std::istringstream stream(*argv);
+      stream >> nazimuth;
+      argv++, argc--;
+    }
+
+  distance *= 1000;
+
+  // --------------------------------------------------------------------------
+  // Read the sites and group them by tile so each mosaic is loaded once
+  // --------------------------------------------------------------------------
+
+  std::vector<Site> sites;
+  std::string line;
+  while(std::getline(std::cin, line))
+    {
+      std::istringstream stream(line);
+      double sx;
+      double sy;
+      if(!(stream >> sx >> sy))continue;
+      if(!pixels) { sx *= double(TILERES); sy *= double(TILERES); }
+      Site site;
+      site.fIndex = sites.size();
+      site.fX = DTEDMap::round(int32_t(floor(sx+0.5)),TILERES);
+      site.fY = int32_t(floor(sy+0.5));
+      site.fTileX = (site.fX>=0) ? site.fX/int32_t(TILERES) :
+	-((-site.fX+int32_t(TILERES)-1)/int32_t(TILERES));
+      site.fTileY = (site.fY>=0) ? site.fY/int32_t(TILERES) :
+	-((-site.fY+int32_t(TILERES)-1)/int32_t(TILERES));
+      sites.push_back(site);
+    }
+  std::sort(sites.begin(), sites.end());
+
+  std::cerr << "Sites: " << sites.size() << std::endl;
+
+  DTEDTileIndex index(directory);
+  index.load();
+
+  DTEDHorizon horizon(distance, nazimuth, wgs84_r, refraction);
+  DTEDMapPtr map;
+
+  for(unsigned i=0;i<sites.size();i++)
+    {
+      const Site& site = sites[i];
+      if((map == 0)||(site.fTileX != sites[i-1].fTileX)||
+	 (site.fTileY != sites[i-1].fTileY))
+	{
+	  map.reset();
+	  unsigned mx;
+	  unsigned my;
+	  double max_lat =
+	    std::max(fabs(double(site.fTileY)),fabs(double(site.fTileY+1)));
+	  horizon.margin(std::min(max_lat,89.0), TILERES, mx, my);
+	  map = DTEDMap::loadSRTMRegionFromDir(directory,
+					       TILERES+2*mx+1, TILERES+2*my+1,
+					       site.fTileX*int32_t(TILERES)-mx,
+					       site.fTileY*int32_t(TILERES)-my,
+					       TILERES, &index);
+	  std::cerr << "Loaded mosaic: " << site.fTileX << ',' << site.fTileY
+		    << std::endl;
+	}
+
+      DTEDHorizonProfile profile;
+      std::vector<uint8_t> visible;
+      horizon.compute(*map, map->xOf(site.fX), map->yOf(site.fY),
+		      observer_height, profile, viewshed ? &visible : 0);
+
+      std::cout << site.fIndex << ' '
+		<< double(site.fX)/double(TILERES) << ' '
+		<< double(site.fY)/double(TILERES) << ' '
+		<< profile.fGroundElevation << ' '
+		<< profile.fObstruction;
+      if(viewshed)
+	std::cout << ' ' << std::count(visible.begin(), visible.end(), 1);
+      for(unsigned j=0;j<profile.fElevation.size();j++)
+	std::cout << ' ' << profile.fElevation[j];
+      std::cout << std::endl;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,64 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file index_srtm.cpp
+
+  Program to build or refresh the tile index of SRTM directories
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#include <string>
+
+#include <VSOptions.hpp>
+#include <DTEDTileIndex.hpp>
+
+using namespace VERITAS;
+
+int main(int argc, char** argv)
+{
+  VSOptions options(argc,argv);
+
+  bool full = false;
+  if(options.find("full") != VSOptions::FS_NOT_FOUND)full=true;
+
+  char* progname = *argv;
+  argv++, argc--;
+
+  if(argc == 0)
+    {
+      std::cerr << "Usage: " << progname
+		<< " [-full] directory [directories]" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+
+  int status = EXIT_SUCCESS;
+
+  while(argc)
+    {
+      std::string directory(*argv);
+      argv++, argc--;
+
+      DTEDTileIndex index(directory);
+      if(!full)index.load();
+
+      unsigned nread = index.update(full);
+
+      std::cerr << directory << ": " << index.size() << " tiles, "
+		<< nread << " read" << std::endl;
+
+      if(!index.save())
+	{
+	  std::cerr << directory << ": could not write "
+		    << index.indexFilename() << std::endl;
+	  status = EXIT_FAILURE;
+	}
+    }
+
+  return status;
+}
@@ -16,11 +16,10 @@
 #include <string>
 #include <sstream>
 
-#include <netinet/in.h>
-
 #include <VSOptions.hpp>
 #include <VSDBFactory.hpp>
 #include <DTED.hpp>
+#include <DTEDFileDb.hpp>
 
 using namespace VERITAS;
 
@@ -36,6 +35,14 @@ int main(int argc, char ** argv)
   bool create_db = false;
   if(options.find("create_db") != VSOptions::FS_NOT_FOUND)create_db=true;
 
+  // --------------------------------------------------------------------------
+  // With -file_db the database is a local memory mapped file rather than
+  // a database on the server
+  // --------------------------------------------------------------------------
+
+  bool file_db = false;
+  if(options.find("file_db") != VSOptions::FS_NOT_FOUND)file_db=true;
+
   char *progname = *argv;
   argv++, argc--;
 
@@ -46,7 +53,7 @@ int main(int argc, char ** argv)
   if(argc<1)
     {
       std::cerr << "Usage: " << progname 
-		<< " [-create_db] database [filenames]" 
+		<< " [-create_db] [-file_db] database [filenames]" 
 		<< std::endl;
       exit(EXIT_FAILURE);
     }
@@ -58,14 +65,24 @@ int main(int argc, char ** argv)
   // Create the database if requested and connect
   // --------------------------------------------------------------------------
   
-  VSDatabase* db = VSDBFactory::getInstance()->createVSDB();
+  VSDatabase* db = 0;
+  DTEDDb* dted = 0;
 
-  if(create_db)
-    db->createDatabase(database,
-		       VSDatabase::FLAG_NO_ERROR_ON_EXIST_OR_NOT_EXIST);
+  if(file_db)
+    {
+      dted = new DTEDFileDb(database);
+    }
+  else
+    {
+      db = VSDBFactory::getInstance()->createVSDB();
+
+      if(create_db)
+	db->createDatabase(database,
+			   VSDatabase::FLAG_NO_ERROR_ON_EXIST_OR_NOT_EXIST);
 
-  db->useDatabase(database);
-  DTEDDb* dted = new DTEDDb(db);
+      db->useDatabase(database);
+      dted = new DTEDSQLDb(db);
+    }
 
   // --------------------------------------------------------------------------
   // Create database structure
@@ -89,48 +106,32 @@ int main(int argc, char ** argv)
 
   while(argc)
     {
-      unsigned w = 1201;
-      unsigned h = 1201;
-
       std::string filename = std::string(*argv);
       argc--; argv++;
 
       std::cerr << filename << ": ";
 
-      std::string basename;
-      if(filename.rfind("/") != std::string::npos)
-	basename = filename.substr(filename.rfind("/")+1);
-      else
-	basename = filename;
-
+      // Tiles may be raw, gzipped or zipped
       int32_t latitude = 0;
       int32_t longitude = 0;
-      VSDataConverter::fromString(latitude, basename.substr(1,2));
-      if(basename[0]=='S')latitude = -latitude;
-      VSDataConverter::fromString(longitude, basename.substr(4,3));
-      if(basename[3]=='W')longitude = -longitude;
+      if(!DTEDMap::parseSRTMTileName(filename, longitude, latitude))continue;
 
-      FILE* fp = fopen(filename.c_str(), "r");
-      if(!fp)continue;
+      DTEDMapPtr map_i =
+	DTEDMap::loadSRTMTile(filename, parameters.fPointsPerDegree);
+      if(!map_i)continue;
 
       std::cerr << longitude << ',' << latitude << ' ';
 
       latitude *= parameters.fPointsPerDegree; 
       longitude *= parameters.fPointsPerDegree;
 
-      int16_t* data = new int16_t[w*h];
-      assert(fread(data, sizeof(*data), w*h, fp) == w*h);
-      fclose(fp);
-
-      DTEDMap map_i(w,h,longitude,latitude,data);
-
-      w=1200; // Last row and column is duplicated in each tile
-      h=1200;
+      unsigned w=1200; // Last row and column is duplicated in each tile
+      unsigned h=1200;
       DTEDMap map_o(w,h,longitude,latitude);
 
       for(unsigned y=0;y<h;y++)
 	for(unsigned x=0;x<w;x++)
-	  map_o(x,y) = ntohs(map_i(x,map_i.height()-y-1));
+	  map_o(x,y) = (*map_i)(x,y);
 
 #if 0
       for(int y=0;y<h;y++)
@@ -151,8 +152,6 @@ int main(int argc, char ** argv)
       int count = dted->loadMapViaFile(map_o);
       std::cerr << count << std::endl;
 #endif 
-
-      delete[] data;
     }
 
   delete dted;
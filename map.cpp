@@ -19,6 +19,9 @@
 #include <cmath>
 
 #include <DTED.hpp>
+#include <DTEDTileIndex.hpp>
+#include <DTEDResample.hpp>
+#include <DTEDParallel.hpp>
 
 using namespace VERITAS;
 
@@ -36,14 +39,25 @@ int main(int argc, char** argv)
   double long_zero = -118.25;       // Degrees (default is centered on LA)
   double radius = 10;               // KM
   double approx_resolution = 0.090; // KM
+  std::string kernel_name;          // box, bilinear or lanczos
   
   char* progname = *argv;
   argv++, argc--;
 
+  // Only leading arguments are taken as options, since west longitudes
+  // and south latitudes start with a minus sign too. Pinned threads keep
+  // working on the memory they first touched when the mosaic was created.
+  if(argc && (std::string(*argv) == "-pin_threads"))
+    {
+      dtedPinThreads(&std::cerr);
+      argv++, argc--;
+    }
+
   if(argc == 0)
     {
       std::cerr << "Usage: " << progname 
-		<< " directory [long] [lat] [radius] [res]" << std::endl;
+		<< " [-pin_threads] directory [long] [lat] [radius] [res] [kernel]"
+		<< std::endl;
       exit(EXIT_FAILURE);
     }
 
@@ -78,9 +92,65 @@ int main(int argc, char** argv)
       argv++, argc--;
     }
 
+  if(argc)
+    {
+      kernel_name = std::string(*argv);
+      argv++, argc--;
+    }
+
   radius *= 1000;
   approx_resolution *= 1000;
 
+  // --------------------------------------------------------------------------
+  // With a kernel, resample onto a WGS84 east-north grid with spacing res
+  // --------------------------------------------------------------------------
+
+  if(!kernel_name.empty())
+    {
+      DTEDResampler::Kernel kernel;
+      if(!DTEDResampler::kernelByName(kernel_name, kernel))
+	{
+	  std::cerr << "Unknown kernel: " << kernel_name << std::endl;
+	  exit(EXIT_FAILURE);
+	}
+
+      unsigned n = 2*unsigned(ceil(radius/approx_resolution))+1;
+      DTEDLocalGrid grid(long_zero, lat_zero, n, n, approx_resolution);
+      DTEDResampler resampler(kernel);
+
+      int32_t left;
+      int32_t bottom;
+      unsigned w;
+      unsigned h;
+      resampler.footprint(grid, TILERES, left, bottom, w, h);
+
+      DTEDTileIndex index(directory);
+      index.load();
+      DTEDMapPtr map = 
+	DTEDMap::loadSRTMRegionFromDir(directory, w, h, left, bottom,
+				       TILERES, &index);
+
+      std::vector<float> el;
+      resampler.resample(*map, grid, el);
+
+      std::cerr << "Image:     " << n << " x " << n << std::endl;
+
+      for(unsigned ix=0; ix<n; ix++)
+	for(unsigned iy=0; iy<n; iy++)
+	  {
+	    double x_deg = grid.pointLongitude(ix,iy);
+	    if(x_deg >= 180.0)x_deg -= 360.0;
+	    else if(x_deg < -180.0)x_deg += 360.0;
+	    std::cout << x_deg << ' '
+		      << grid.pointLatitude(ix,iy) << ' '
+		      << grid.easting(ix)/1000.0 << ' '
+		      << grid.northing(iy)/1000.0 << ' '
+		      << el[iy*n+ix] << std::endl;
+	  }
+
+      return EXIT_SUCCESS;
+    }
+
   int32_t cen_x = int32_t(floor((long_zero)*double(TILERES)));
   int32_t cen_y = int32_t(floor((lat_zero)*double(TILERES)));
 
@@ -122,24 +192,16 @@ int main(int argc, char** argv)
 	    << DTEDMap::round(tile_r,1) << ',' << tile_t << " = " 
 	    << tile_w << " x " << tile_h << std::endl;
 
- 
-  DTEDMap map(tile_w*TILERES+1, tile_h*TILERES+1,
-	      tile_l*TILERES, tile_b*TILERES, TILERES);
 
-  for(int32_t x = tile_l; x<tile_r; x++)
-    for(int32_t y = tile_b; y<tile_t; y++)
-      {
-	int32_t _x = DTEDMap::round(x,1);
-	int32_t _y = y;
+  DTEDTileIndex index(directory);
+  index.load();
 
-	DTEDMap* tile = DTEDMap::loadSRTMTileFromDir(directory,_x,_y);
-	if(tile)
-	  {
-	    std::cerr << "Loaded tile: " << _x << ',' << _y;
-	    map.merge(*tile);
-	    delete tile;	    
-	  }
-      }
+  DTEDMapPtr map_ptr = 
+    DTEDMap::loadSRTMRegionFromDir(directory, 
+				   tile_w*TILERES+1, tile_h*TILERES+1,
+				   tile_l*TILERES, tile_b*TILERES, TILERES,
+				   &index);
+  DTEDMap& map = *map_ptr;
 
   unsigned y_step = unsigned(floor(approx_resolution/wgs84_r/M_PI*180*1200));
   if(y_step==0)y_step=1;
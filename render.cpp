@@ -0,0 +1,222 @@
+//-*-mode:c++; mode:font-lock;-*-
+
+/*! \file render.cpp
+
+  Program to render hillshaded colour-relief PNG maps around a list of
+  candidate sites, with the sites marked
+
+  \author     Stephen Fegan               \n
+              UCLA                        \n
+              sfegan@astro.ucla.edu       \n
+
+  \version    0.1
+  \date       19/10/2026
+  \note
+*/
+
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <cmath>
+
+#include <VSOptions.hpp>
+#include <DTED.hpp>
+#include <DTEDTileIndex.hpp>
+#include <DTEDResample.hpp>
+#include <DTEDRender.hpp>
+
+using namespace VERITAS;
+
+int main(int argc, char** argv)
+{
+  VSOptions options(argc,argv);
+
+  // --------------------------------------------------------------------------
+  // Sites are read from stdin as "longitude latitude" in degrees, or with
+  // -pixels as the pixel coordinates in the first columns of find_flat.
+  // One map is written per site, with every site that falls on it marked.
+  // --------------------------------------------------------------------------
+
+  bool pixels = false;
+  if(options.find("pixels") != VSOptions::FS_NOT_FOUND)pixels=true;
+
+  // With -native the map pixels are rendered as they are, otherwise the
+  // map is resampled onto a square east-north grid as with draw_map.m
+  bool native = false;
+  if(options.find("native") != VSOptions::FS_NOT_FOUND)native=true;
+
+  std::string kernel_name = "bilinear";
+  double azimuth = 315;             // Degrees
+  double altitude = 45;             // Degrees
+  double exaggeration = 1;
+  double ambient = 0.35;
+  double marker_radius = 0.1;       // KM
+  options.findWithValue("kernel", kernel_name);
+  options.findWithValue("azimuth", azimuth);
+  options.findWithValue("altitude", altitude);
+  options.findWithValue("exaggeration", exaggeration);
+  options.findWithValue("ambient", ambient);
+  options.findWithValue("marker", marker_radius);
+
+  DTEDResampler::Kernel kernel;
+  if(!DTEDResampler::kernelByName(kernel_name, kernel))
+    {
+      std::cerr << "Unknown kernel: " << kernel_name << std::endl;
+      exit(EXIT_FAILURE);
+    }
+
+  const uint32_t TILERES = 1200;
+
+  const double wgs84_a = 6378136.49; // m
+  const double wgs84_b = 6356751.7;
+  const double wgs84_r = (wgs84_a+wgs84_b)/2.0;
+
+  double radius = 3;                // KM
+  double approx_resolution = 0.050; // KM
+
+  char* progname = *argv;
+  argv++, argc--;
+
+  if(argc < 2)
+    {
+      std::cerr << "Usage: " << progname
+		<< " [-pixels] [-native] [-kernel=name] [-azimuth=deg]"
+		<< " [-altitude=deg] [-exaggeration=x] [-ambient=f]"
+		<< " [-marker=km] directory prefix [radius] [res] < sites"
+		<< std::endl;
+      exit(EXIT_FAILURE);
+    }
+
+  std::string directory(*argv);
+  argv++, argc--;
+
+  std::string prefix(*argv);
+  argv++, argc--;
+
+  if(argc)
+    {
+      std::istringstream stream(*argv);
+      stream >> radius;
+      argv++, argc--;
+    }
+
+  if(argc)
+    {
+      std::istringstream stream(*argv);
+      stream >> approx_resolution;
+      argv++, argc--;
+    }
+
+  radius *= 1000;
+  approx_resolution *= 1000;
+  marker_radius *= 1000;
+
+  std::vector<double> site_lon;
+  std::vector<double> site_lat;
+  std::string line;
+  while(std::getline(std::cin, line))
+    {
+      std::istringstream stream(line);
+      double sx;
+      double sy;
+      if(!(stream >> sx >> sy))continue;
+      if(pixels) { sx /= double(TILERES); sy /= double(TILERES); }
+      site_lon.push_back(sx);
+      site_lat.push_back(sy);
+    }
+
+  std::cerr << "Sites: " << site_lon.size() << std::endl;
+
+  DTEDTileIndex index(directory);
+  index.load();
+
+  DTEDRenderer renderer;
+  renderer.setLight(azimuth, altitude);
+  renderer.setExaggeration(exaggeration);
+  renderer.setAmbient(ambient);
+
+  for(unsigned i=0;i<site_lon.size();i++)
+    {
+      std::vector<uint8_t> rgba;
+      std::vector<DTEDMarker> markers;
+      unsigned w;
+      unsigned h;
+
+      if(native)
+	{
+	  const double scale_y = wgs84_r*M_PI/180.0/double(TILERES);
+	  const double scale_x = scale_y*cos(site_lat[i]/180.0*M_PI);
+	  const int32_t mx = int32_t(ceil(radius/scale_x));
+	  const int32_t my = int32_t(ceil(radius/scale_y));
+	  const int32_t cx = int32_t(floor(site_lon[i]*double(TILERES)+0.5));
+	  const int32_t cy = int32_t(floor(site_lat[i]*double(TILERES)+0.5));
+	  DTEDMapPtr map =
+	    DTEDMap::loadSRTMRegionFromDir(directory, 2*mx+1, 2*my+1,
+					   cx-mx, cy-my, TILERES, &index);
+	  renderer.render(*map, rgba, wgs84_r);
+	  w = map->width();
+	  h = map->height();
+
+	  for(unsigned j=0;j<site_lon.size();j++)
+	    {
+	      double dlon = site_lon[j]-site_lon[i];
+	      if(dlon >= 180.0)dlon -= 360.0;
+	      else if(dlon < -180.0)dlon += 360.0;
+	      markers.push_back(DTEDMarker(dlon*double(TILERES)+double(mx),
+					   site_lat[j]*double(TILERES)-
+					   double(cy-my),
+					   marker_radius/scale_y));
+	    }
+	}
+      else
+	{
+	  const unsigned n = 2*unsigned(ceil(radius/approx_resolution))+1;
+	  DTEDLocalGrid grid(site_lon[i], site_lat[i], n, n,
+			     approx_resolution, wgs84_a, wgs84_b);
+	  DTEDResampler resampler(kernel);
+
+	  int32_t left;
+	  int32_t bottom;
+	  unsigned mw;
+	  unsigned mh;
+	  resampler.footprint(grid, TILERES, left, bottom, mw, mh);
+	  DTEDMapPtr map =
+	    DTEDMap::loadSRTMRegionFromDir(directory, mw, mh, left, bottom,
+					   TILERES, &index);
+
+	  std::vector<float> el;
+	  resampler.resample(*map, grid, el);
+	  renderer.render(&el.front(), n, n,
+			  approx_resolution, approx_resolution, rgba);
+	  w = n;
+	  h = n;
+
+	  for(unsigned j=0;j<site_lon.size();j++)
+	    {
+	      double dlon = site_lon[j]-site_lon[i];
+	      if(dlon >= 180.0)dlon -= 360.0;
+	      else if(dlon < -180.0)dlon += 360.0;
+	      if(fabs(dlon) >= 90.0)continue;
+	      double easting;
+	      double northing;
+	      grid.toLocal(site_lon[i]+dlon, site_lat[j], easting, northing);
+	      markers.push_back(DTEDMarker(easting/approx_resolution +
+					   0.5*double(n-1),
+					   northing/approx_resolution +
+					   0.5*double(n-1),
+					   marker_radius/approx_resolution));
+	    }
+	}
+
+      DTEDRenderer::mark(rgba, w, h, markers);
+
+      std::ostringstream filename;
+      filename << prefix << std::setw(4) << std::setfill('0') << i << ".png";
+      if(!DTEDRenderer::writePNG(filename.str(), w, h, rgba))
+	exit(EXIT_FAILURE);
+      std::cerr << "Wrote " << filename.str() << std::endl;
+    }
+
+  return EXIT_SUCCESS;
+}